@@ -0,0 +1,467 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <map>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <math.h>
+#include <stdio.h>
+#include "tinyxml2/tinyxml2.h"
+#include "primitives.h"
+#include "mesh.h"
+#include "scene.h"
+#include "bundle.h"
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace tinyxml2;
+
+/*
+* Micro-benchmarks of the loading paths: primitive generation, text and
+* binary model files, scene XML and its cache, and tinyxml2's number parsing.
+*
+* Every benchmark runs once to warm up and then a number of timed runs;
+* the median is compared against a baseline file written by an earlier
+* run, and the exit status is 1 when some benchmark got slower than the
+* threshold allows.
+*
+*	bench [--runs N] [--filter TEXT] [--baseline FILE] [--save-baseline FILE] [--threshold PERCENT]
+*
+* The bench_baseline and bench_compare build targets run it with a baseline
+* kept in the build directory (BENCH_BASELINE in the CMake cache).
+*/
+
+#define BENCH_RUNS				15
+#define BENCH_THRESHOLD			10.0	// percent slower than the baseline counted as a regression
+#define BENCH_SMALL_GROUPS		10
+#define BENCH_LARGE_GROUPS		14000	// top level groups of the large scene, each with nested ones; under SCENE_STREAM_BYTES
+#define BENCH_LARGE_NESTED		4
+#define BENCH_FLOATS			100000
+#define BENCH_WIDE_ATTRIBUTES	48		// attributes of each element of the wide document
+#define BENCH_WIDE_ELEMENTS		2000
+
+class BenchResult
+{
+public:
+	string name;
+	double mean;		// milliseconds
+	double deviation;	// standard deviation, milliseconds
+	double median;
+	double min;
+};
+
+int runs = BENCH_RUNS;
+string filter;
+vector<BenchResult> results;
+
+double milliseconds(chrono::steady_clock::time_point start, chrono::steady_clock::time_point end)
+{
+	return chrono::duration<double, milli>(end - start).count();
+}
+
+/*
+* Times body; reset, when given, runs after every run and outside the
+* timing, to undo what the body did.
+*/
+void bench(const string& name, function<void()> body, function<void()> reset = nullptr)
+{
+	if (!filter.empty() && name.find(filter) == string::npos)
+		return;
+
+	body();
+	if (reset)
+		reset();
+
+	vector<double> times;
+	for (int i = 0; i < runs; i++)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		body();
+		times.push_back(milliseconds(start, chrono::steady_clock::now()));
+		if (reset)
+			reset();
+	}
+
+	BenchResult r;
+	r.name = name;
+	r.mean = 0;
+	for (double t : times)
+		r.mean += t;
+	r.mean /= times.size();
+
+	r.deviation = 0;
+	for (double t : times)
+		r.deviation += (t - r.mean) * (t - r.mean);
+	r.deviation = times.size() > 1 ? sqrt(r.deviation / (times.size() - 1)) : 0;
+
+	sort(times.begin(), times.end());
+	r.median = times[times.size() / 2];
+	r.min = times[0];
+	results.push_back(r);
+
+	char line[160];
+	snprintf(line, sizeof(line), "%-32s median %10.3f ms  mean %10.3f ms  +- %5.1f%%  min %10.3f ms",
+		name.c_str(), r.median, r.mean, r.mean > 0 ? 100 * r.deviation / r.mean : 0, r.min);
+	cout << line << endl;
+}
+
+void benchPrimitives()
+{
+	// Each primitive at a low, a medium and a high resolution
+	Mesh mesh;
+	vector<pair<string, vector<float>>> specs = {
+		{ "plane",		{ 10, 16 } },	{ "plane",		{ 10, 128 } },		{ "plane",		{ 10, 512 } },
+		{ "box",		{ 10, 4 } },	{ "box",		{ 10, 32 } },		{ "box",		{ 10, 128 } },
+		{ "sphere",		{ 1, 16, 16 } },	{ "sphere",		{ 1, 64, 64 } },	{ "sphere",		{ 1, 256, 256 } },
+		{ "cone",		{ 1, 2, 16, 16 } },	{ "cone",		{ 1, 2, 64, 64 } },	{ "cone",		{ 1, 2, 256, 256 } },
+		{ "cylinder",	{ 1, 2, 16 } },	{ "cylinder",	{ 1, 2, 256 } },	{ "cylinder",	{ 1, 2, 4096 } }
+	};
+
+	for (const pair<string, vector<float>>& spec : specs)
+	{
+		string name = "generate " + spec.first;
+		for (float p : spec.second)
+			name += " " + to_string((int)p);
+
+		bench(name, [&]()
+		{
+			buildPrimitive(spec.first, spec.second, mesh);
+		}, [&]()
+		{
+			mesh = Mesh();
+		});
+	}
+}
+
+void benchModels(const filesystem::path& directory)
+{
+	// The same mesh in both formats
+	Mesh mesh;
+	sphere(1, 256, 256, mesh);
+	string text = (directory / "sphere.3d").string();
+	string binary = (directory / "sphere.bin").string();
+	if (!writeModel(mesh, text.c_str(), MODEL_TEXT) || !writeModel(mesh, binary.c_str(), MODEL_BINARY))
+	{
+		cout << "Could not write the benchmark models!" << endl;
+		return;
+	}
+
+	Mesh loaded;
+	bench("load text sphere 256", [&]()
+	{
+		readModel(text.c_str(), loaded);
+	}, [&]()
+	{
+		loaded = Mesh();
+	});
+	bench("load binary sphere 256", [&]()
+	{
+		readModel(binary.c_str(), loaded);
+	}, [&]()
+	{
+		loaded = Mesh();
+	});
+}
+
+void writeGroup(ostream& out, int index, int nested)
+{
+	out << "<group><translate x=\"" << index % 100 << "\" y=\"0\" z=\"" << index / 100 << "\"/>"
+		<< "<rotate angle=\"" << index % 360 << "\" x=\"0\" y=\"1\" z=\"0\"/>"
+		<< "<scale x=\"0.5\" y=\"0.5\" z=\"0.5\"/>"
+		<< "<models><model primitive=\"sphere\" radius=\"1\" slices=\"" << 8 + index % 8 << "\" stacks=\"8\"/></models>";
+	for (int i = 0; i < nested; i++)
+		writeGroup(out, index * nested + i, 0);
+	out << "</group>\n";
+}
+
+bool writeScene(const string& fileName, int groups, int nested)
+{
+	ofstream out(fileName);
+	out << "<world>\n<window width=\"800\" height=\"800\"/>\n"
+		<< "<camera><position x=\"10\" y=\"10\" z=\"10\"/><lookAt x=\"0\" y=\"0\" z=\"0\"/><up x=\"0\" y=\"1\" z=\"0\"/>"
+		<< "<projection fov=\"60\" near=\"1\" far=\"1000\"/></camera>\n";
+	for (int i = 0; i < groups; i++)
+		writeGroup(out, i, nested);
+	out << "</world>\n";
+	return !out.fail();
+}
+
+void benchScenes(const filesystem::path& directory)
+{
+	string small = (directory / "small.xml").string();
+	string large = (directory / "large.xml").string();
+	if (!writeScene(small, BENCH_SMALL_GROUPS, 0) || !writeScene(large, BENCH_LARGE_GROUPS, BENCH_LARGE_NESTED))
+	{
+		cout << "Could not write the benchmark scenes!" << endl;
+		return;
+	}
+
+	// loadXML would stream a larger scene, and the DOM path would no longer be timed
+	error_code error;
+	if (filesystem::file_size(large, error) >= SCENE_STREAM_BYTES)
+		cout << "The large scene is streamed, loadXML large times streamScene!" << endl;
+
+	bench("loadXML small", [&]()
+	{
+		loadXML(&small[0]);
+	}, clearScene);
+	// Reloads into a document that keeps its buffers, as hot reload does
+	XMLDocument retained;
+	retained.SetRetainMemory(true);
+	bench("loadScene small retained", [&]()
+	{
+		loadScene(small.c_str(), world, retained);
+	}, clearScene);
+	bench("loadXML large", [&]()
+	{
+		loadXML(&large[0]);
+	}, clearScene);
+	bench("streamScene large", [&]()
+	{
+		streamScene(large.c_str(), world);
+	}, clearScene);
+
+	// The document alone, read into a buffer or mapped
+	XMLDocument document;
+	bench("XMLDocument::LoadFile large", [&]()
+	{
+		document.LoadFile(large.c_str());
+	}, [&]()
+	{
+		document.Clear();
+	});
+	bench("XMLDocument::MapFile large", [&]()
+	{
+		document.MapFile(large.c_str());
+	}, [&]()
+	{
+		document.Clear();
+	});
+
+	// The same scene read back from the cache the engine keeps of parsed scenes
+	string cache = (directory / "large.scene").string();
+	uint64_t hash = 0, source;
+	loadXML(&large[0]);
+	bool written = fileHash(large.c_str(), hash) && writeBundle(cache.c_str(), world, hash, false);
+	clearScene();
+	if (!written)
+	{
+		cout << "Could not write the benchmark scene cache!" << endl;
+		return;
+	}
+	bench("scene cache large", [&]()
+	{
+		loadBundle(cache.c_str(), world, source);
+	}, clearScene);
+}
+
+void benchNumbers()
+{
+	vector<string> values;
+	for (int i = 0; i < BENCH_FLOATS; i++)
+		values.push_back(to_string((i - BENCH_FLOATS / 2) * 0.37f));
+
+	float sum = 0;
+	bench("XMLUtil::ToFloat", [&]()
+	{
+		float value;
+		for (const string& v : values)
+		{
+			XMLUtil::ToFloat(v.c_str(), &value);
+			sum += value;
+		}
+	});
+
+	vector<string> integers;
+	for (int i = 0; i < BENCH_FLOATS; i++)
+		integers.push_back(to_string(i * 7 - BENCH_FLOATS));
+
+	bench("XMLUtil::ToInt", [&]()
+	{
+		int value;
+		for (const string& v : integers)
+		{
+			XMLUtil::ToInt(v.c_str(), &value);
+			sum += value;
+		}
+	});
+
+	// x, y and z of a transform, one attribute at a time and all three at once
+	XMLDocument document;
+	document.Parse("<translate x=\"1.5\" y=\"-2.25\" z=\"1e3\" time=\"0\"/>");
+	const XMLElement* pElement = document.RootElement();
+	bench("QueryFloatAttribute x y z", [&]()
+	{
+		float xyz[3];
+		for (int i = 0; i < BENCH_FLOATS; i++)
+		{
+			pElement->QueryFloatAttribute("x", &xyz[0]);
+			pElement->QueryFloatAttribute("y", &xyz[1]);
+			pElement->QueryFloatAttribute("z", &xyz[2]);
+			sum += xyz[0] + xyz[1] + xyz[2];
+		}
+	});
+	bench("QueryFloatTriple x y z", [&]()
+	{
+		float xyz[3];
+		for (int i = 0; i < BENCH_FLOATS; i++)
+		{
+			pElement->QueryFloatTriple("x", "y", "z", xyz);
+			sum += xyz[0] + xyz[1] + xyz[2];
+		}
+	});
+
+	// Elements carrying dozens of attributes, parsed and then looked up by name
+	string wide = "<scene>";
+	for (int i = 0; i < BENCH_WIDE_ELEMENTS; i++)
+	{
+		wide += "<point";
+		for (int j = 0; j < BENCH_WIDE_ATTRIBUTES; j++)
+			wide += " p" + to_string(j) + "=\"" + to_string(i + j) + "\"";
+		wide += "/>";
+	}
+	wide += "</scene>";
+
+	XMLDocument wideDocument;
+	bench("Parse wide elements", [&]()
+	{
+		wideDocument.Parse(wide.c_str(), wide.size());
+	});
+
+	wideDocument.Parse(wide.c_str(), wide.size());
+	const XMLElement* pWide = wideDocument.RootElement()->FirstChildElement();
+	vector<string> names;
+	for (int j = 0; j < BENCH_WIDE_ATTRIBUTES; j++)
+		names.push_back("p" + to_string(j));
+	bench("FindAttribute wide element", [&]()
+	{
+		for (int i = 0; i < BENCH_FLOATS / BENCH_WIDE_ATTRIBUTES; i++)
+		{
+			for (const string& name : names)
+				sum += pWide->FindAttribute(name.c_str()) != NULL;
+		}
+	});
+
+	// Keeps the loop from being optimized away
+	if (sum == 1234.5f)
+		cout << sum << endl;
+}
+
+bool readBaseline(const string& fileName, map<string, double>& baseline)
+{
+	// One "median name" pair per line
+	ifstream in(fileName);
+	if (!in)
+		return false;
+
+	string line;
+	while (getline(in, line))
+	{
+		istringstream fields(line);
+		double median;
+		string name;
+		if (fields >> median && getline(fields >> ws, name))
+			baseline[name] = median;
+	}
+	return true;
+}
+
+bool writeBaseline(const string& fileName)
+{
+	ofstream out(fileName);
+	char line[160];
+	for (const BenchResult& r : results)
+	{
+		snprintf(line, sizeof(line), "%.6f %s", r.median, r.name.c_str());
+		out << line << "\n";
+	}
+	return !out.fail();
+}
+
+int compareBaseline(const map<string, double>& baseline, double threshold)
+{
+	int regressions = 0;
+	char line[160];
+
+	cout << endl << "Against the baseline:" << endl;
+	for (const BenchResult& r : results)
+	{
+		map<string, double>::const_iterator b = baseline.find(r.name);
+		if (b == baseline.end() || b->second <= 0)
+		{
+			snprintf(line, sizeof(line), "%-32s no baseline", r.name.c_str());
+			cout << line << endl;
+			continue;
+		}
+
+		double change = 100 * (r.median - b->second) / b->second;
+		bool regressed = change > threshold;
+		regressions += regressed ? 1 : 0;
+		snprintf(line, sizeof(line), "%-32s %10.3f ms -> %10.3f ms  %+6.1f%%%s",
+			r.name.c_str(), b->second, r.median, change, regressed ? "  REGRESSION" : "");
+		cout << line << endl;
+	}
+	return regressions;
+}
+
+int main(int argc, char** argv)
+{
+	string baselineFile, saveFile;
+	double threshold = BENCH_THRESHOLD;
+
+	for (int i = 1; i < argc; i++)
+	{
+		string option = argv[i];
+		if (option == "--runs" && i + 1 < argc)
+			runs = max(1, stoi(argv[++i]));
+		else if (option == "--filter" && i + 1 < argc)
+			filter = argv[++i];
+		else if (option == "--baseline" && i + 1 < argc)
+			baselineFile = argv[++i];
+		else if (option == "--save-baseline" && i + 1 < argc)
+			saveFile = argv[++i];
+		else if (option == "--threshold" && i + 1 < argc)
+			threshold = stod(argv[++i]);
+		else
+		{
+			cout << "Unknown option " << option << "!" << endl;
+			return 1;
+		}
+	}
+
+	map<string, double> baseline;
+	if (!baselineFile.empty() && !readBaseline(baselineFile, baseline))
+	{
+		cout << "Could not read baseline " << baselineFile << "!" << endl;
+		return 1;
+	}
+
+	// Model files and scenes are written to a scratch directory first, one per run
+	error_code error;
+	filesystem::path directory = filesystem::temp_directory_path(error) / ("engine_bench." + to_string(getpid()));
+	filesystem::create_directories(directory, error);
+
+	benchPrimitives();
+	benchModels(directory);
+	benchScenes(directory);
+	benchNumbers();
+
+	filesystem::remove_all(directory, error);
+
+	if (!saveFile.empty() && !writeBaseline(saveFile))
+		cout << "Could not write baseline " << saveFile << "!" << endl;
+
+	if (!baselineFile.empty())
+		return compareBaseline(baseline, threshold) > 0 ? 1 : 0;
+	return 0;
+}
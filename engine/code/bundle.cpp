@@ -0,0 +1,538 @@
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <map>
+#include <cstring>
+#include "bundle.h"
+#include "profiler.h"
+#include "memstats.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+static_assert(sizeof(BundleHeader) == 80, "bundle header layout");
+static_assert(sizeof(BundleModel) == 72, "bundle model layout");
+
+#define FNV_OFFSET	0xcbf29ce484222325ULL
+#define FNV_PRIME	0x100000001b3ULL
+
+bool fileHash(const char* fileName, uint64_t& hash)
+{
+	ifstream file(fileName, ios::binary);
+	if (!file)
+		return false;
+
+	hash = FNV_OFFSET;
+	char buffer[64 * 1024];
+	while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0)
+	{
+		for (streamsize i = 0; i < file.gcount(); i++)
+		{
+			hash ^= (unsigned char)buffer[i];
+			hash *= FNV_PRIME;
+		}
+	}
+	return true;
+}
+
+bool isBundle(const char* fileName)
+{
+	char magic[4] = { 0 };
+	ifstream file(fileName, ios::binary);
+	return file.read(magic, sizeof(magic)) && memcmp(magic, BUNDLE_MAGIC, sizeof(magic)) == 0;
+}
+
+// Writing
+
+class BundleWriter
+{
+public:
+	vector<uint32_t> scene;
+	vector<BundleModel> models;
+	vector<const ModelData*> data;		// loaded data of each model, for the vertices
+	map<string, uint32_t> indices;		// model key -> entry in models
+	string strings;
+
+	void word(uint32_t value)
+	{
+		scene.push_back(value);
+	}
+
+	void number(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		scene.push_back(bits);
+	}
+
+	uint32_t model(const Model& m)
+	{
+		string key = m.key();
+		map<string, uint32_t>::iterator found = indices.find(key);
+		if (found != indices.end())
+			return found->second;
+
+		const string& name = m.primitive.empty() ? m.file : m.primitive;
+		BundleModel entry = {};
+		entry.name = (uint32_t)strings.size();
+		entry.nameLength = (uint32_t)name.size();
+		entry.primitive = m.primitive.empty() ? 0 : 1;
+		entry.paramCount = (uint32_t)min<size_t>(m.params.size(), 4);
+		for (uint32_t i = 0; i < entry.paramCount; i++)
+			entry.params[i] = m.params[i];
+		strings += name;
+
+		uint32_t index = (uint32_t)models.size();
+		indices[key] = index;
+		models.push_back(entry);
+		data.push_back(m.data);
+		return index;
+	}
+};
+
+static void writeGroup(BundleWriter& writer, const Group& group)
+{
+	/*
+	* transform count, model count, nested group count, then every
+	* transform: type, x, y, z, angle, time, align, point count and the
+	* points; then the model table index of every model, and the nested
+	* groups the same way
+	*/
+	writer.word((uint32_t)group.transforms.size());
+	writer.word((uint32_t)group.models.size());
+	writer.word((uint32_t)group.groups.size());
+
+	for (const Transform& t : group.transforms)
+	{
+		writer.word((uint32_t)t.type);
+		writer.number(t.vector.x);
+		writer.number(t.vector.y);
+		writer.number(t.vector.z);
+		writer.number(t.angle);
+		writer.number(t.time);
+		writer.word(t.align ? 1 : 0);
+
+		const vector<vec3>* points = t.path ? &t.path->curve.points : NULL;
+		writer.word(points ? (uint32_t)points->size() : 0);
+		if (points)
+		{
+			for (const vec3& p : *points)
+			{
+				writer.number(p.x);
+				writer.number(p.y);
+				writer.number(p.z);
+			}
+		}
+	}
+
+	for (const Model& m : group.models)
+		writer.word(writer.model(m));
+
+	for (const Group& child : group.groups)
+		writeGroup(writer, child);
+}
+
+static int countGroups(const Group& group)
+{
+	int count = 1;
+	for (const Group& child : group.groups)
+		count += countGroups(child);
+	return count;
+}
+
+static uint64_t aligned(uint64_t offset)
+{
+	return (offset + BUNDLE_ALIGN - 1) & ~(uint64_t)(BUNDLE_ALIGN - 1);
+}
+
+static void pad(ofstream& file, uint64_t offset)
+{
+	static const char zeros[BUNDLE_ALIGN] = { 0 };
+	file.write(zeros, aligned(offset) - offset);
+}
+
+bool writeBundle(const char* fileName, const World& scene, uint64_t source, bool vertices)
+{
+	BundleWriter writer;
+	const Window& w = scene.window;
+	const Camera& c = scene.camera;
+
+	writer.word((uint32_t)w.width);
+	writer.word((uint32_t)w.height);
+	for (const vec3* v : { &c.position, &c.lookAt, &c.upVector })
+	{
+		writer.number(v->x);
+		writer.number(v->y);
+		writer.number(v->z);
+	}
+	writer.number(c.projection.fov);
+	writer.number(c.projection.near);
+	writer.number(c.projection.far);
+
+	int groups = 0;
+	writer.word((uint32_t)scene.groups.size());
+	for (const Group& g : scene.groups)
+	{
+		writeGroup(writer, g);
+		groups += countGroups(g);
+	}
+
+	BundleHeader header = {};
+	memcpy(header.magic, BUNDLE_MAGIC, sizeof(header.magic));
+	header.version = BUNDLE_VERSION;
+	header.source = source;
+	header.models = (uint32_t)writer.models.size();
+	header.groups = (uint32_t)groups;
+	header.sceneOffset = aligned(sizeof(BundleHeader));
+	header.sceneSize = writer.scene.size() * sizeof(uint32_t);
+	header.modelsOffset = aligned(header.sceneOffset + header.sceneSize);
+	header.stringsOffset = aligned(header.modelsOffset + writer.models.size() * sizeof(BundleModel));
+	header.stringsSize = writer.strings.size();
+	header.verticesOffset = aligned(header.stringsOffset + header.stringsSize);
+
+	// Every model's vertices start aligned, after the ones before it
+	uint64_t offset = header.verticesOffset;
+	for (size_t i = 0; i < writer.models.size(); i++)
+	{
+		BundleModel& entry = writer.models[i];
+		const ModelData* data = writer.data[i];
+		if (data != NULL)
+		{
+			entry.bounds[0] = data->bounds.min.x;
+			entry.bounds[1] = data->bounds.min.y;
+			entry.bounds[2] = data->bounds.min.z;
+			entry.bounds[3] = data->bounds.max.x;
+			entry.bounds[4] = data->bounds.max.y;
+			entry.bounds[5] = data->bounds.max.z;
+		}
+		if (!vertices || data == NULL || data->vertexCount() == 0)
+			continue;
+
+		entry.vertices = offset;
+		entry.vertexCount = data->vertexCount();
+		offset = aligned(offset + entry.vertexCount * sizeof(Point));
+	}
+	header.verticesSize = offset - header.verticesOffset;
+
+	// Written aside and renamed over the old bundle, which an engine may have mapped
+	ostringstream tmpName;
+	tmpName << fileName << "." << this_thread::get_id() << ".tmp";
+	string tmp = tmpName.str();
+
+	ofstream file(tmp, ios::binary);
+	if (!file)
+		return false;
+
+	file.write((const char*)&header, sizeof(header));
+	pad(file, sizeof(header));
+	file.write((const char*)writer.scene.data(), header.sceneSize);
+	pad(file, header.sceneOffset + header.sceneSize);
+	file.write((const char*)writer.models.data(), writer.models.size() * sizeof(BundleModel));
+	pad(file, header.modelsOffset + writer.models.size() * sizeof(BundleModel));
+	file.write(writer.strings.data(), header.stringsSize);
+	pad(file, header.stringsOffset + header.stringsSize);
+
+	for (size_t i = 0; i < writer.models.size(); i++)
+	{
+		const BundleModel& entry = writer.models[i];
+		if (entry.vertices == 0)
+			continue;
+		file.write((const char*)writer.data[i]->vertexData(), entry.vertexCount * sizeof(Point));
+		pad(file, entry.vertices + entry.vertexCount * sizeof(Point));
+	}
+
+	file.close();
+	error_code ec;
+	if (!file.fail())
+		filesystem::rename(tmp, fileName, ec);
+	if (file.fail() || ec)
+	{
+		filesystem::remove(tmp, ec);
+		return false;
+	}
+	return true;
+}
+
+// Loading
+
+class BundleReader
+{
+public:
+	const uint32_t* next;
+	const uint32_t* end;
+	bool ok = true;			// false once something was read past the end
+
+	uint32_t word()
+	{
+		if (next == end)
+		{
+			ok = false;
+			return 0;
+		}
+		return *next++;
+	}
+
+	// Words left, to check counts before allocating for them
+	size_t remaining() const
+	{
+		return end - next;
+	}
+
+	float number()
+	{
+		uint32_t bits = word();
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	vec3 vector()
+	{
+		float x = number();
+		float y = number();
+		return vec3(x, y, number());
+	}
+};
+
+static bool readGroup(BundleReader& reader, const vector<Model>& models, Group& group)
+{
+	uint32_t transforms = reader.word();
+	uint32_t modelCount = reader.word();
+	uint32_t groups = reader.word();
+
+	// Every transform takes 8 words at least, every group 3
+	if (!reader.ok || transforms > reader.remaining() / 8 || modelCount > reader.remaining() || groups > reader.remaining() / 3)
+		return false;
+
+	group.transforms.resize(transforms);
+	for (Transform& t : group.transforms)
+	{
+		t.type = (Transform::Type)reader.word();
+		t.vector = reader.vector();
+		t.angle = reader.number();
+		t.time = reader.number();
+		t.align = reader.word() != 0;
+
+		uint32_t pointCount = reader.word();
+		if (pointCount > reader.remaining() / 3)
+			return false;
+		if (pointCount > 0)
+		{
+			vector<vec3> points(pointCount);
+			for (vec3& p : points)
+				p = reader.vector();
+
+			// Arc length tables are cheap to rebuild and much larger than the points
+			t.path = make_shared<Path>();
+			t.path->curve = Curve(points);
+			t.path->curve.build();
+		}
+	}
+
+	group.models.reserve(modelCount);
+	for (uint32_t i = 0; i < modelCount; i++)
+	{
+		uint32_t index = reader.word();
+		if (index >= models.size())
+			return false;
+		group.models.push_back(models[index]);
+	}
+
+	group.groups.resize(groups);
+	for (Group& child : group.groups)
+	{
+		if (!readGroup(reader, models, child))
+			return false;
+	}
+	return reader.ok;
+}
+
+static const char* mapBundle(const char* fileName, size_t& size)
+{
+#ifndef _WIN32
+	int fd = open(fileName, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+
+	struct stat info;
+	void* mapping = MAP_FAILED;
+	if (fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(BundleHeader))
+		mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	size = info.st_size;
+	return mapping == MAP_FAILED ? NULL : (const char*)mapping;
+#else
+	// Read into memory where files can't be mapped; kept like a mapping would be
+	ifstream file(fileName, ios::binary | ios::ate);
+	if (!file)
+		return NULL;
+	size = (size_t)file.tellg();
+	if (size < sizeof(BundleHeader))
+		return NULL;
+	char* buffer = new char[size];
+	file.seekg(0);
+	if (!file.read(buffer, size))
+	{
+		delete[] buffer;
+		return NULL;
+	}
+	return buffer;
+#endif
+}
+
+static void unmapBundle(const char* base, size_t size)
+{
+#ifndef _WIN32
+	munmap((void*)base, size);
+#else
+	delete[] base;
+#endif
+}
+
+// True when count items of itemSize bytes from offset on lie within the file; can't overflow
+static bool within(uint64_t offset, uint64_t count, uint64_t itemSize, size_t size)
+{
+	return offset <= size && count <= (size - offset) / itemSize;
+}
+
+// Unmaps the bundle when loading stops, unless models were left using it
+class BundleMapping
+{
+public:
+	const char* base;
+	size_t size;
+
+	BundleMapping(const char* mappingBase, size_t mappingSize) : base(mappingBase), size(mappingSize) {};
+	~BundleMapping()
+	{
+		if (base != NULL)
+			unmapBundle(base, size);
+	}
+	BundleMapping(const BundleMapping&) = delete;
+	BundleMapping& operator=(const BundleMapping&) = delete;
+
+	// Kept for the rest of the run
+	void keep()
+	{
+		base = NULL;
+	}
+};
+
+static bool readScene(BundleReader& reader, const vector<Model>& models, World& scene)
+{
+	scene.window.width = (int)reader.word();
+	scene.window.height = (int)reader.word();
+	scene.camera.position = reader.vector();
+	scene.camera.lookAt = reader.vector();
+	scene.camera.upVector = reader.vector();
+	scene.camera.projection.fov = reader.number();
+	scene.camera.projection.near = reader.number();
+	scene.camera.projection.far = reader.number();
+
+	uint32_t groups = reader.word();
+	if (groups > reader.remaining() / 3)
+		return false;
+	scene.groups.resize(groups);
+	for (Group& g : scene.groups)
+	{
+		if (!readGroup(reader, models, g))
+			return false;
+		prepareGroup(g);
+	}
+	return reader.ok;
+}
+
+static void resolveStored(Group& group)
+{
+	for (Model& m : group.models)
+	{
+		map<string, ModelData>::iterator cached = modelCache.find(m.key());
+		if (cached != modelCache.end())
+			m.data = &cached->second;
+	}
+	for (Group& child : group.groups)
+		resolveStored(child);
+}
+
+bool loadBundle(const char* fileName, World& scene, uint64_t& source)
+{
+	PROFILE_SCOPE("load bundle");
+
+	size_t size;
+	const char* base = mapBundle(fileName, size);
+	if (base == NULL)
+		return false;
+	BundleMapping mapping(base, size);
+
+	// Every section must lie within the file before anything is read
+	BundleHeader header;
+	memcpy(&header, base, sizeof(header));
+	if (memcmp(header.magic, BUNDLE_MAGIC, sizeof(header.magic)) != 0 || header.version != BUNDLE_VERSION
+		|| !within(header.sceneOffset, header.sceneSize, 1, size)
+		|| !within(header.modelsOffset, header.models, sizeof(BundleModel), size)
+		|| !within(header.stringsOffset, header.stringsSize, 1, size)
+		|| !within(header.verticesOffset, header.verticesSize, 1, size))
+		return false;
+
+	const BundleModel* entries = (const BundleModel*)(base + header.modelsOffset);
+	const char* strings = base + header.stringsOffset;
+
+	vector<Model> models(header.models);
+	for (uint32_t i = 0; i < header.models; i++)
+	{
+		const BundleModel& entry = entries[i];
+		if (!within(entry.name, entry.nameLength, 1, header.stringsSize)
+			|| (entry.vertices != 0 && !within(entry.vertices, entry.vertexCount, sizeof(Point), size)))
+			return false;
+
+		string name(strings + entry.name, entry.nameLength);
+		Model& m = models[i];
+		if (entry.primitive)
+		{
+			m.primitive = name;
+			m.params.assign(entry.params, entry.params + min<uint32_t>(entry.paramCount, 4));
+		}
+		else
+			m.file = name;
+	}
+
+	BundleReader reader;
+	reader.next = (const uint32_t*)(base + header.sceneOffset);
+	reader.end = reader.next + header.sceneSize / sizeof(uint32_t);
+
+	// A broken scene graph leaves nothing behind, the model cache isn't touched until here
+	if (!readScene(reader, models, scene))
+	{
+		scene.groups.clear();
+		return false;
+	}
+
+	// Stored vertices are used from the mapping, without loading anything
+	for (uint32_t i = 0; i < header.models; i++)
+	{
+		const BundleModel& entry = entries[i];
+		if (entry.vertices == 0)
+			continue;
+
+		ModelData& d = modelCache[models[i].key()];
+		d.mapped.view((const Point*)(base + entry.vertices), entry.vertexCount);
+		d.bounds = AABB(vec3(entry.bounds[0], entry.bounds[1], entry.bounds[2]), vec3(entry.bounds[3], entry.bounds[4], entry.bounds[5]));
+		memoryAdd(MEMORY_MESHES, meshBytes(d));
+		mapping.keep();
+	}
+	for (Group& g : scene.groups)
+		resolveStored(g);
+
+	source = header.source;
+	return true;
+}
@@ -0,0 +1,78 @@
+#ifndef BUNDLE_H
+#define BUNDLE_H
+
+#include <stdint.h>
+#include "scene.h"
+
+/*
+* Scene bundles: a scene graph and the models it references packed into
+* one file, which is loaded by mapping it instead of parsing anything.
+*
+* Layout, little endian, every section starting at a multiple of
+* BUNDLE_ALIGN bytes:
+*	BundleHeader
+*	scene graph, a stream of 32 bit words (see writeGroup in bundle.cpp)
+*	BundleModel table, one entry per distinct model
+*	string table with the names of model files and primitives
+*	vertices of every model, packed floats as in binary model files
+*
+* Models may also be stored without vertices, in which case they are
+* loaded from their file or primitive spec like models of a scene XML.
+*/
+
+#define BUNDLE_MAGIC	"CGSB"
+#define BUNDLE_VERSION	1
+#define BUNDLE_ALIGN	16
+
+class BundleHeader
+{
+public:
+	char magic[4];
+	uint32_t version;
+	uint64_t source;			// hash of the scene XML the bundle was made from
+	uint32_t models;			// entries in the model table
+	uint32_t groups;			// groups at every level
+	uint64_t sceneOffset;
+	uint64_t sceneSize;
+	uint64_t modelsOffset;
+	uint64_t stringsOffset;
+	uint64_t stringsSize;
+	uint64_t verticesOffset;
+	uint64_t verticesSize;
+};
+
+class BundleModel
+{
+public:
+	uint32_t name;				// file or primitive name, offset in the string table
+	uint32_t nameLength;
+	uint32_t primitive;			// 1 for primitive specs, 0 for model files
+	uint32_t paramCount;
+	float params[4];
+	float bounds[6];			// min and max corners
+	uint64_t vertices;			// offset of the vertices in the file, 0 when not stored
+	uint64_t vertexCount;
+};
+
+// FNV-1a hash of a file's contents, false if it can't be read
+bool fileHash(const char* fileName, uint64_t& hash);
+
+// True when the file starts like a bundle
+bool isBundle(const char* fileName);
+
+/*
+* Packs scene into a bundle. With vertices, every model must be loaded
+* (its data set) and its vertices are stored as well.
+*/
+bool writeBundle(const char* fileName, const World& scene, uint64_t source, bool vertices);
+
+/*
+* Maps a bundle and reads its scene graph into scene. Models stored with
+* vertices are added to modelCache using the mapped vertices in place, so
+* the mapping is kept for the rest of the run; the others are left for
+* loadModels. source is set to the hash of the scene XML. A broken bundle
+* is unmapped and leaves scene without groups and modelCache untouched.
+*/
+bool loadBundle(const char* fileName, World& scene, uint64_t& source);
+
+#endif
@@ -0,0 +1,44 @@
+#include <iostream>
+#include <string>
+#include "scene.h"
+#include "bundle.h"
+
+using namespace std;
+
+/*
+* Packs a scene XML and every model it references into one bundle file,
+* which the engine loads in place of the XML.
+*
+*	bundler <scene.xml> <scene.bundle> [--no-vertices]
+*
+* With --no-vertices only the scene graph is packed, and the engine loads
+* the models from their files or primitive specs as usual.
+*/
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		cout << "Insuficient arguments, specify the scene and the bundle files!" << endl;
+		return 1;
+	}
+
+	bool vertices = !(argc >= 4 && string(argv[3]) == "--no-vertices");
+
+	uint64_t source;
+	if (!fileHash(argv[1], source) || !loadScene(argv[1], world))
+	{
+		cout << "Could not load scene " << argv[1] << "!" << endl;
+		return 1;
+	}
+	if (vertices)
+		loadModels();
+
+	if (!writeBundle(argv[2], world, source, vertices))
+	{
+		cout << "Could not write " << argv[2] << "!" << endl;
+		return 1;
+	}
+
+	cout << argv[2] << ": " << world.groups.size() << " top level groups, " << modelCache.size() << " models" << endl;
+	return 0;
+}
@@ -1,4 +1,9 @@
 #include <stdlib.h>
+#ifdef _WIN32
+#include <GL/glew.h>
+#else
+#define GL_GLEXT_PROTOTYPES
+#endif
 #ifdef __APPLE__
 #include <GLUT/glut.h>
 #else
@@ -9,252 +14,450 @@
 #include <fstream>
 #include <vector>
 #include <string>
+#include <map>
+#include <set>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <filesystem>
+#include <math.h>
+#include "scene.h"
+#include "profiler.h"
+#include "memstats.h"
+#include "watcher.h"
+#include "bundle.h"
 #include "tinyxml2/tinyxml2.h"
 
 using namespace std;
-using namespace tinyxml2;
 
-class Point
+// Global Variables
+
+/*
+* Animation clock: simulated time advances in fixed steps, independent of
+* how often frames are drawn, and world matrices are only recomputed for
+* the groups a step actually moves.
+*/
+#define ANIMATION_STEP_MS	(1000 / 60)
+
+bool animationRunning = false;	// the clock's timer is scheduled
+double animationTime = 0;		// simulated seconds
+int animationLastTick = 0;		// GLUT_ELAPSED_TIME of the last clock tick
+int animationAccumulator = 0;	// elapsed milliseconds not yet simulated
+
+/*
+* Frame scheduler: nothing redraws continuously. Whatever changes the
+* picture (camera, window, animation, reloaded data, render settings)
+* marks the frame dirty through requestFrame, and a single redisplay is
+* posted for all the changes made until it runs, no sooner than the
+* optional frame rate cap allows.
+*/
+#define FRAME_CAMERA	0x01
+#define FRAME_WINDOW	0x02
+#define FRAME_ANIMATION	0x04
+#define FRAME_DATA		0x08
+#define FRAME_SETTINGS	0x10
+
+unsigned int frameDirty = 0;	// FRAME_* reasons for the pending frame
+bool frameScheduled = false;	// a redisplay is already posted or waiting on the cap
+int frameRateCap = 0;			// maximum frames per second, 0 for no cap
+int lastFrameTime = 0;			// GLUT_ELAPSED_TIME of the last frame drawn
+
+/*
+* Interactive camera. Orbit mode turns around the lookAt point (arrows or
+* left drag, zoom with +/- or right drag and the wheel); first person mode
+* moves with w/a/s/d and looks around with the arrows or left drag. 'c'
+* switches between them. The view matrix and the frustum are only rebuilt
+* when the camera actually moves, and so is the culling of every group.
+*/
+enum CameraMode { CAMERA_ORBIT, CAMERA_FPS };
+
+CameraMode cameraMode = CAMERA_ORBIT;
+mat4 viewMatrix;				// cached view matrix, rebuilt by cameraChanged
+mat4 projectionMatrix;			// cached projection matrix, rebuilt by changeSize
+Frustum frustum;				// planes of projectionMatrix * viewMatrix
+float cameraStep = 1;			// first person step, scaled to the initial camera distance
+int mouseButton = -1;			// button being dragged, -1 when none
+int mouseX, mouseY;				// last drag position
+
+int visibleGroups = 0;			// groups passing the frustum test
+int totalGroups = 0;
+
+/*
+* Benchmark mode: the camera orbits at a fixed rate and frames are drawn
+* back to back for the given number of seconds, then timing and culling
+* statistics are printed and the engine exits.
+*/
+#define BENCHMARK_ORBIT_SPEED 30.0f	// degrees per second
+
+float benchmarkSeconds = 0;		// benchmark length, 0 when not benchmarking
+int benchmarkStart = -1;		// GLUT_ELAPSED_TIME of the first benchmark frame
+int benchmarkFrames = 0;
+double benchmarkVisible = 0;	// visible groups summed over the benchmark frames
+
+// Profiler output: overlay toggled with 'f', event exports written at exit
+bool showProfiler = false;
+string profileCSV;				// --profile-csv file, empty for none
+string profileTrace;			// --profile-trace file, empty for none
+
+// Memory report printed with 'm', largest models first; benchmark results as JSON
+#define MEMORY_REPORT_MODELS 10
+
+string benchJSON;				// --bench-json file, empty for none
+
+/*
+* Hot reload (--watch): the scene file and the model files it uses are
+* watched, whatever changed is parsed or read again on the watcher thread,
+* and the results are swapped in between frames by reloadTick. Reloading
+* the scene keeps the current camera.
+*/
+#define RELOAD_POLL_MS 100
+
+class Reload
 {
 public:
-	float x;
-	float y;
-	float z;
+	bool scene = false;				// world holds a newly parsed scene
+	World world;
+	map<string, ModelData> meshes;	// meshes read again or needed for the first time, by key
+};
 
-	Point() {};
-	Point(float xCoord, float yCoord, float zCoord)
-	{
-		x = xCoord;
-		y = yCoord;
-		z = zCoord;
-	}
+/*
+* Model streaming: the window opens as soon as the scene is parsed, while
+* loader threads read and generate the meshes. streamTick uploads the ones
+* that are ready, no more than the upload budget per frame; until then a
+* model has an empty mesh and its group is bounded by its origin alone.
+* Benchmarks and --sync-load read every model before the window opens.
+*/
+#define STREAM_THREADS		4
+#define STREAM_POLL_MS		16
+#define STREAM_BUDGET		(16 * 1024 * 1024)	// bytes uploaded per frame, the first mesh always goes
+#define STREAM_BOUNDS_MS	250					// least time between bounds refreshes while streaming
+
+class StreamJob
+{
+public:
+	Model model;
+	std::string key;			// placeholder in the model cache, looked up again when uploading
+	ModelData loaded;			// filled by a loader thread
+};
+
+bool syncLoad = false;
+size_t uploadBudget = STREAM_BUDGET;
+vector<StreamJob> streamJobs;
+atomic<size_t> streamNext(0);	// next job for a loader thread
+atomic<bool> streamStop(false);	// set at exit, loaders finish the job in hand and return
+vector<thread> streamThreads;
+mutex streamMutex;
+vector<StreamJob*> streamReady;	// loaded and waiting for upload, guarded by streamMutex
+size_t streamUploaded = 0;		// jobs uploaded so far
+int streamBoundsTime = 0;		// GLUT_ELAPSED_TIME of the last bounds refresh
+
+/*
+* Residency (--memory-budget MB): binary models are mapped instead of read,
+* and only the vertex buffers of recently drawn models are kept, within the
+* budget. A visible model without a buffer is uploaded straight from its
+* mapping, up to the upload budget per frame; once over the memory budget,
+* the buffers unused the longest are deleted and their pages dropped, to
+* be read from the file again when they come back into view. Primitives
+* and text models can't be read again cheaply and always stay resident.
+* Models of a bundle are always uploaded this way, from the bundle's
+* mapping, so the per frame accounting runs with or without a budget.
+*/
+size_t memoryBudget = 0;			// bytes of buffers of mapped models, 0 for no budget
+size_t residentBytes = 0;			// bytes of those buffers currently uploaded
+list<ModelData*> residentModels;	// mapped models with a buffer, most recently used first
+unsigned int residencyFrame = 1;	// frame number for ModelData::lastUsed
+size_t residencyUploaded = 0;		// bytes uploaded from mappings in the current frame
+int residencyMissed = 0;			// visible models that couldn't be uploaded this frame
+int residencyWaiting = 0;			// the same for the last finished frame
+
+string sceneFile;
+bool sceneBundle = false;		// the scene was loaded from a bundle, which isn't watched
+bool watchReload = false;
+mutex reloadMutex;				// guards pendingReload, and modelCache against the watcher thread
+Reload pendingReload;
+bool reloadPending = false;
+
+int polygonMode = 0;
 
-	string toString()
+void groupBounds(Group& group)
+{
+	// Union of the model bounds moved to world space
+	bool first = true;
+	for (const Model& m : group.models)
 	{
-		return to_string(x) + " " + to_string(y) + " " + to_string(z);
+		AABB box = m.data->bounds.transformed(group.world);
+		if (first)
+			group.bounds = box;
+		else
+		{
+			group.bounds.extend(box.min);
+			group.bounds.extend(box.max);
+		}
+		first = false;
 	}
-};
+}
 
-class Vector
+void cullGroup(Group& group)
 {
-public:
-	float x;
-	float y;
-	float z;
+	// Groups with no models of their own have nothing to cull
+	group.visible = group.models.empty() || frustum.intersects(group.bounds);
+}
+
+void cullGroups(Group& group)
+{
+	cullGroup(group);
+	visibleGroups += group.visible ? 1 : 0;
+	totalGroups++;
+
+	for (Group& child : group.groups)
+		cullGroups(child);
+}
+
+void cullWorld()
+{
+	PROFILE_SCOPE("cull");
 
-	Vector() {};
-	Vector(float xCoord, float yCoord, float zCoord)
+	// Only needed when the view changes, moving groups are culled as they move
+	visibleGroups = 0;
+	totalGroups = 0;
+	for (Group& g : world.groups)
+		cullGroups(g);
+}
+
+void updateGroup(Group& group, const mat4& parent, double seconds, bool parentChanged)
+{
+	/*
+	* Recomputes the world matrix of timed groups and of groups whose parent
+	* moved; subtrees without anything timed and with a still parent are
+	* never visited.
+	*/
+	bool changed = parentChanged || group.timed;
+
+	if (group.timed)
 	{
-		x = xCoord;
-		y = yCoord;
-		z = zCoord;
+		mat4 m = parent;
+		for (Transform& t : group.transforms)
+		{
+			if (t.path)
+				t.pathMatrix = m;
+			m = m * t.matrix(seconds);
+		}
+		group.world = m;
+	}
+	else if (parentChanged)
+	{
+		group.world = parent * group.local;
 	}
-};
 
-class Projection
-{
-public:
-	int fov;
-	int near;
-	int far;
+	if (changed)
+	{
+		bool wasVisible = group.visible;
+		groupBounds(group);
+		cullGroup(group);
+		visibleGroups += (group.visible ? 1 : 0) - (wasVisible ? 1 : 0);
+	}
 
-	Projection() {};
-	Projection(int newFov, int newNear, int newFar)
+	for (Group& child : group.groups)
 	{
-		fov = newFov;
-		near = newNear;
-		far = newFar;
+		if (changed || child.animated)
+			updateGroup(child, group.world, seconds, changed);
 	}
-};
+}
 
-class Window
+void updateWorld(bool all)
 {
-public:
-	int width;
-	int height;
+	PROFILE_SCOPE("animate");
 
-	Window() {};
-	Window(int newWidth, int newHeight)
+	for (Group& g : world.groups)
 	{
-		width = newWidth;
-		height = newHeight;
+		if (all || g.animated)
+			updateGroup(g, mat4(), animationTime, all);
 	}
-};
+}
 
-class Camera
+void uploadModel(ModelData& data)
 {
-public:
-	Point position;
-	Point lookAt;
-	Vector upVector;
-	Projection projection;
+	size_t bytes = data.vertexCount() * sizeof(Point);
+	glGenBuffers(1, &data.buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, data.buffer);
+	glBufferData(GL_ARRAY_BUFFER, bytes, data.vertexData(), GL_STATIC_DRAW);
+	data.bufferSize = bytes;
+	memoryAdd(MEMORY_VERTEX_BUFFERS, bytes);
 
-	Camera() {};
-	Camera(Point newPosition, Point newLookAt, Vector newUpVector, Projection newProjection)
+	// Buffers of mapped models can be evicted, and the pages they came from aren't needed meanwhile
+	if (data.mapped.vertices != NULL)
 	{
-		position = newPosition;
-		lookAt = newLookAt;
-		upVector = newUpVector;
-		projection = newProjection;
+		residentModels.push_front(&data);
+		data.resident = residentModels.begin();
+		residentBytes += bytes;
+		data.mapped.release();
 	}
-};
+}
 
-class Group
+void releaseModel(ModelData& data)
 {
-public:
-	vector<string> models;
-};
+	if (data.buffer == 0)
+		return;
 
-class World
-{
-public:
-	Window window;
-	Camera camera;
-	vector <Group> groups;
-};
+	if (data.mapped.vertices != NULL)
+	{
+		residentModels.erase(data.resident);
+		residentBytes -= data.bufferSize;
+	}
+	memoryRemove(MEMORY_VERTEX_BUFFERS, data.bufferSize);
+	glDeleteBuffers(1, &data.buffer);
+	data.buffer = 0;
+	data.bufferSize = 0;
+}
 
-// Global Variables
+void touchModel(ModelData& data)
+{
+	// First use of a mapped model in this frame
+	if (data.lastUsed == residencyFrame)
+		return;
+	data.lastUsed = residencyFrame;
 
-vector<Point> vertices;
-World world;
+	if (data.buffer != 0)
+	{
+		residentModels.splice(residentModels.begin(), residentModels, data.resident);
+		return;
+	}
 
-int polygonMode = 0;
+	if (residencyUploaded == 0 || residencyUploaded + data.mapped.bytes() <= uploadBudget)
+	{
+		residencyUploaded += data.mapped.bytes();
+		uploadModel(data);
+	}
+	else
+	{
+		// Read ahead now, uploaded in one of the next frames
+		data.mapped.prefetch();
+		residencyMissed++;
+	}
+}
 
-void loadXML(char* fileName)
+void uploadModels()
 {
-	XMLDocument xmlFile;
+	PROFILE_SCOPE("upload");
 
-	// Load the XML file into the Doc instance
-	xmlFile.LoadFile(fileName);
+	// One static vertex buffer per distinct model, requires the GL context
+	// Mapped models are uploaded when first drawn
+	for (pair<const string, ModelData>& entry : modelCache)
+	{
+		if (!entry.second.streaming && entry.second.mapped.vertices == NULL)
+			uploadModel(entry.second);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
 
-	// Get root Element
-	XMLElement* pRootElement = xmlFile.RootElement();
+void postFrame(int value)
+{
+	glutPostRedisplay();
+}
 
-	// Enter rootElement which is World
-	if (pRootElement != NULL)
-	{
-		// Enter window element
-		XMLElement* pWindow = pRootElement->FirstChildElement("window");
-		if (pWindow != NULL)
-		{
-			int width = stoi(pWindow->Attribute("width"));
-			int height = stoi(pWindow->Attribute("height"));
+void requestFrame(unsigned int reason)
+{
+	frameDirty |= reason;
+	if (frameScheduled)
+		return;
+	frameScheduled = true;
 
-			// Create window in global variable world
-			world.window = Window(width, height);
-		}
+	int wait = 0;
+	if (frameRateCap > 0)
+		wait = 1000 / frameRateCap - (glutGet(GLUT_ELAPSED_TIME) - lastFrameTime);
 
-		// Enter camera element
-		XMLElement* pCamera = pRootElement->FirstChildElement("camera");
-		if (pCamera != NULL)
-		{
-			float x, y, z;
-			Point position, lookAt;
-			Vector upVector;
-			Projection projection;
-
-			// Enter position element
-			XMLElement* pPosition = pCamera->FirstChildElement("position");
-			if (pPosition != NULL)
-			{
-				// Camera Position
-				x = stof(pPosition->Attribute("x"));
-				y = stof(pPosition->Attribute("y"));
-				z = stof(pPosition->Attribute("z"));
+	if (wait > 0)
+		glutTimerFunc(wait, postFrame, 0);
+	else
+		glutPostRedisplay();
+}
 
-				position = Point(x, y, z);
-			}
+void evictModels()
+{
+	// Least recently used first, never what this frame drew
+	while (residentBytes > memoryBudget && !residentModels.empty() && residentModels.back()->lastUsed != residencyFrame)
+		releaseModel(*residentModels.back());
+}
 
-			// Enter lookAt element
-			XMLElement* pLookAt = pCamera->FirstChildElement("lookAt");
-			if (pLookAt != NULL)
-			{
-				// Camera lookAt
-				x = stof(pLookAt->Attribute("x"));
-				y = stof(pLookAt->Attribute("y"));
-				z = stof(pLookAt->Attribute("z"));
-				lookAt = Point(x, y, z);
-			}
+void endResidencyFrame()
+{
+	if (memoryBudget > 0)
+		evictModels();
 
-			// Enter up element
-			XMLElement* pUpVector = pCamera->FirstChildElement("up");
-			if (pUpVector != NULL)
-			{
-				// Camera upVector
-				x = stof(pUpVector->Attribute("x"));
-				y = stof(pUpVector->Attribute("y"));
-				z = stof(pUpVector->Attribute("z"));
-				upVector = Vector(x, y, z);
-			}
+	// Models that missed the upload budget get another frame
+	residencyFrame++;
+	residencyUploaded = 0;
+	residencyWaiting = residencyMissed;
+	if (residencyMissed > 0)
+	{
+		residencyMissed = 0;
+		requestFrame(FRAME_DATA);
+	}
+}
 
-			// Enter projection element
-			XMLElement* pProjection = pCamera->FirstChildElement("projection");
-			if (pProjection != NULL)
-			{
-				// Camera Projection
-				x = stoi(pProjection->Attribute("fov"));
-				y = stoi(pProjection->Attribute("near"));
-				z = stoi(pProjection->Attribute("far"));
-				projection = Projection(x, y, z);
-			}
+void cameraChanged()
+{
+	viewMatrix = mat4::lookAt(world.camera.position, world.camera.lookAt, world.camera.upVector);
+	frustum = Frustum::fromMatrix(projectionMatrix * viewMatrix);
+	cullWorld();
+	requestFrame(FRAME_CAMERA);
+}
 
-			// Create camera in global variable world
-			world.camera = Camera(position, lookAt, upVector, projection);
-		}
+void orbitCamera(float dAlpha, float dBeta)
+{
+	// Spherical coordinates of the position around lookAt, in degrees
+	vec3 offset = world.camera.position - world.camera.lookAt;
+	float radius = length(offset);
+	if (radius <= 0)
+		return;
 
-		// Run through every group element
-		XMLElement* pGroup = pRootElement->FirstChildElement("group");
-		while (pGroup)
-		{
-			Group group;
+	float alpha = atan2f(offset.x, offset.z) + dAlpha * VECMATH_PI / 180.0f;
+	float beta = asinf(fmaxf(-1.0f, fminf(1.0f, offset.y / radius))) + dBeta * VECMATH_PI / 180.0f;
+	float limit = 89.0f * VECMATH_PI / 180.0f;
+	beta = fmaxf(-limit, fminf(limit, beta));
 
-			// Enter models element
-			XMLElement* pModels = pGroup->FirstChildElement("models");
-			if (pModels)
-			{
+	world.camera.position = world.camera.lookAt + vec3(cosf(beta) * sinf(alpha), sinf(beta), cosf(beta) * cosf(alpha)) * radius;
+	cameraChanged();
+}
 
-				// Run through every model element
-				XMLElement* pModel = pModels->FirstChildElement("model");
-				while (pModel)
-				{
+void zoomCamera(float factor)
+{
+	vec3 offset = world.camera.position - world.camera.lookAt;
+	if (length(offset * factor) < 0.01f)
+		return;
 
-					// Add model to models vector in group
-					group.models.push_back(pModel->Attribute("file"));
+	world.camera.position = world.camera.lookAt + offset * factor;
+	cameraChanged();
+}
 
-					// Change pointer to next model element
-					pModel = pModel->NextSiblingElement("model");
-				}
-			}
+void lookCamera(float dYaw, float dPitch)
+{
+	// Same as orbiting, but turning the lookAt point around the position
+	vec3 direction = world.camera.lookAt - world.camera.position;
+	float distance = length(direction);
+	if (distance <= 0)
+		return;
 
-			// Add model to group vector in world
-			world.groups.push_back(group);
+	float yaw = atan2f(direction.x, direction.z) - dYaw * VECMATH_PI / 180.0f;
+	float pitch = asinf(fmaxf(-1.0f, fminf(1.0f, direction.y / distance))) + dPitch * VECMATH_PI / 180.0f;
+	float limit = 89.0f * VECMATH_PI / 180.0f;
+	pitch = fmaxf(-limit, fminf(limit, pitch));
 
-			// Change pointer to next group element
-			pGroup = pGroup->NextSiblingElement("group");
-		}
-	}
+	world.camera.lookAt = world.camera.position + vec3(cosf(pitch) * sinf(yaw), sinf(pitch), cosf(pitch) * cosf(yaw)) * distance;
+	cameraChanged();
 }
 
-void loadModels()
+void moveCamera(float forward, float right)
 {
-	for each (Group g in world.groups)
-	{
-		for each (string fileName in g.models)
-		{
-			ifstream file_pointer(fileName, ios::binary | ios::in);
-
-			string linha;
-			float x, y, z;
+	vec3 direction = normalize(world.camera.lookAt - world.camera.position);
+	vec3 side = normalize(cross(direction, world.camera.upVector));
+	vec3 step = direction * (forward * cameraStep) + side * (right * cameraStep);
 
-			while (getline(file_pointer, linha, '\0'))
-			{
-				sscanf_s(linha.c_str(), "%f %f %f", &x, &y, &z);
-				Point p(x, y, z);
-				vertices.push_back(p);
-			}
-			file_pointer.close();
-		}
-	}
+	world.camera.position += step;
+	world.camera.lookAt += step;
+	cameraChanged();
 }
 
 void drawAxis()
@@ -278,6 +481,66 @@ void drawAxis()
 	glEnd();
 }
 
+void drawPath(const Path& path)
+{
+	const vector<vec3>& positions = path.curve.positions;
+
+	// The path never changes, so it is uploaded once and drawn from the buffer
+	if (path.buffer == 0)
+	{
+		glGenBuffers(1, &path.buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, path.buffer);
+		glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(vec3), positions.data(), GL_STATIC_DRAW);
+		memoryAdd(MEMORY_PATH_BUFFERS, positions.size() * sizeof(vec3));
+	}
+
+	glColor3f(1.0f, 1.0f, 1.0f);
+	glBindBuffer(GL_ARRAY_BUFFER, path.buffer);
+	glVertexPointer(3, GL_FLOAT, sizeof(vec3), 0);
+	glDrawArrays(GL_LINE_LOOP, 0, (GLsizei)positions.size());
+}
+
+void drawGroup(const Group& group)
+{
+	// Paths are drawn in the space they are defined in, before moving along them
+	for (const Transform& t : group.transforms)
+	{
+		if (t.path)
+		{
+			glPushMatrix();
+			glMultMatrixf(t.pathMatrix.m);
+			drawPath(*t.path);
+			glPopMatrix();
+		}
+	}
+
+	if (group.visible)
+	{
+		glPushMatrix();
+		glMultMatrixf(group.world.m);
+
+		glColor3f(0.5, 0.5, 0.5);
+		for (const Model& m : group.models)
+		{
+			if (m.data->mapped.vertices != NULL)
+				touchModel(*m.data);
+
+			// Streamed and evicted models are skipped until uploaded
+			if (m.data->buffer == 0)
+				continue;
+			glBindBuffer(GL_ARRAY_BUFFER, m.data->buffer);
+			glVertexPointer(3, GL_FLOAT, 0, 0);
+			glDrawArrays(GL_TRIANGLES, 0, (GLsizei)m.data->vertexCount());
+		}
+
+		glPopMatrix();
+	}
+
+	// World matrices are absolute, so nested groups don't need the matrix stack
+	for (const Group& child : group.groups)
+		drawGroup(child);
+}
+
 void changeSize(int w, int h)
 {
 	// Prevent a divide by zero, when window is too short
@@ -286,46 +549,732 @@ void changeSize(int w, int h)
 		h = 1;
 	// compute window's aspect ratio
 	float ratio = w * 1.0f / h;
-	// Set the projection matrix as current
-	glMatrixMode(GL_PROJECTION);
-	// Load the identity matrix
-	glLoadIdentity();
 	// Set the viewport to be the entire window
 	glViewport(0, 0, w, h);
-	// Set the perspective
-	gluPerspective(45.0f, ratio, 1.0f, 1000.0f);
+	// Build the perspective from the scene's projection, only when the window changes
+	const Projection& projection = world.camera.projection;
+	projectionMatrix = mat4::perspective(projection.fov, ratio, projection.near, projection.far);
+	// Load it as the projection matrix, the same one the frustum is built from
+	glMatrixMode(GL_PROJECTION);
+	glLoadMatrixf(projectionMatrix.m);
 	// return to the model view matrix mode
 	glMatrixMode(GL_MODELVIEW);
+
+	// The frustum depends on the projection as well
+	cameraChanged();
+	requestFrame(FRAME_WINDOW);
+}
+
+void drawText(int x, int y, const char* text)
+{
+	glRasterPos2i(x, y);
+	for (const char* c = text; *c; c++)
+		glutBitmapCharacter(GLUT_BITMAP_9_BY_15, *c);
+}
+
+void drawProfilerOverlay()
+{
+	int count;
+	const ProfileStat* stats = profileStats(count);
+	int w = glutGet(GLUT_WINDOW_WIDTH);
+	int h = glutGet(GLUT_WINDOW_HEIGHT);
+
+	// Window coordinates on top of everything, then back to the scene matrices
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho(0, w, 0, h, -1, 1);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+	glDisable(GL_DEPTH_TEST);
+
+	char line[96];
+	glColor3f(1.0f, 1.0f, 0.0f);
+	for (int i = 0; i < count; i++)
+	{
+		snprintf(line, sizeof(line), "%-12s %8.3f ms", stats[i].name, stats[i].average);
+		drawText(10, h - 20 - i * 16, line);
+	}
+	snprintf(line, sizeof(line), "%-12s %8d / %d", "visible", visibleGroups, totalGroups);
+	drawText(10, h - 20 - count * 16, line);
+
+	glEnable(GL_DEPTH_TEST);
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+}
+
+void writeProfiles()
+{
+	if (!profileCSV.empty() && !profileWriteCSV(profileCSV.c_str()))
+		cout << "Could not write " << profileCSV << "!" << endl;
+	if (!profileTrace.empty() && !profileWriteTrace(profileTrace.c_str()))
+		cout << "Could not write " << profileTrace << "!" << endl;
+}
+
+void printMemoryReport()
+{
+	char line[160], current[32], peak[32], cpu[32], gpu[32];
+
+	cout << "Memory by subsystem (current / peak):" << endl;
+	for (int i = 0; i < MEMORY_SUBSYSTEMS; i++)
+	{
+		MemoryStat stat = memoryStat((MemorySubsystem)i);
+		snprintf(line, sizeof(line), "  %-16s %3s %12s / %s", stat.name, stat.gpu ? "GPU" : "CPU",
+			memoryFormat(stat.current, current, sizeof(current)), memoryFormat(stat.peak, peak, sizeof(peak)));
+		cout << line << endl;
+	}
+	for (int g = 0; g < 2; g++)
+	{
+		snprintf(line, sizeof(line), "  %-16s %3s %12s / %s", "total", g ? "GPU" : "CPU",
+			memoryFormat(memoryCurrent(g != 0), current, sizeof(current)), memoryFormat(memoryPeak(g != 0), peak, sizeof(peak)));
+		cout << line << endl;
+	}
+
+	if (memoryBudget > 0)
+	{
+		snprintf(line, sizeof(line), "  %-16s %3s %12s of %s", "resident", "GPU",
+			memoryFormat(residentBytes, current, sizeof(current)), memoryFormat(memoryBudget, peak, sizeof(peak)));
+		cout << line << endl;
+	}
+
+	// Models, largest first
+	GroupMemory all;
+	for (const Group& g : world.groups)
+		groupMemory(g, all);
+
+	vector<pair<const string*, const ModelData*>> models;
+	for (const pair<const string, ModelData>& entry : modelCache)
+		models.push_back(make_pair(&entry.first, &entry.second));
+	sort(models.begin(), models.end(), [](const pair<const string*, const ModelData*>& a, const pair<const string*, const ModelData*>& b)
+	{
+		return meshBytes(*a.second) > meshBytes(*b.second);
+	});
+
+	cout << "Models (" << models.size() << ", CPU / GPU, uses):" << endl;
+	for (size_t i = 0; i < models.size() && i < MEMORY_REPORT_MODELS; i++)
+	{
+		const ModelData& data = *models[i].second;
+		snprintf(line, sizeof(line), "  %-40s %12s / %-12s %d", models[i].first->c_str(),
+			memoryFormat(meshBytes(data), cpu, sizeof(cpu)), memoryFormat(bufferBytes(data), gpu, sizeof(gpu)), all.references[&data]);
+		cout << line << endl;
+	}
+
+	// Top level groups with everything nested in them; meshes are counted once per group
+	cout << "Groups (nested groups, scene, meshes CPU / GPU):" << endl;
+	for (size_t i = 0; i < world.groups.size(); i++)
+	{
+		GroupMemory memory;
+		groupMemory(world.groups[i], memory);
+
+		size_t meshes, buffers;
+		memory.meshBytes(meshes, buffers);
+		snprintf(line, sizeof(line), "  group %-6zu %8d %12s %12s / %s", i, memory.groups - 1,
+			memoryFormat(memory.scene, current, sizeof(current)), memoryFormat(meshes, cpu, sizeof(cpu)), memoryFormat(buffers, gpu, sizeof(gpu)));
+		cout << line << endl;
+	}
+}
+
+string jsonString(const string& text)
+{
+	string quoted = "\"";
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+			quoted += '\\';
+		quoted += c;
+	}
+	return quoted + "\"";
+}
+
+bool writeBenchJSON(const char* fileName, float elapsed)
+{
+	ofstream file(fileName);
+	if (!file)
+		return false;
+
+	file << "{\n\"frames\": " << benchmarkFrames << ",\n";
+	file << "\"frame_ms\": " << (benchmarkFrames > 0 ? elapsed * 1000 / benchmarkFrames : 0) << ",\n";
+	file << "\"visible_groups\": " << (benchmarkFrames > 0 ? benchmarkVisible / benchmarkFrames : 0) << ",\n";
+	file << "\"total_groups\": " << totalGroups << ",\n";
+	file << "\"models_waiting\": " << residencyWaiting << ",\n";
+
+	int count;
+	const ProfileStat* stats = profileStats(count);
+	file << "\"stages_ms\": {";
+	for (int i = 0; i < count; i++)
+		file << (i ? ", " : "") << jsonString(stats[i].name) << ": " << stats[i].average;
+	file << "},\n";
+
+	file << "\"memory\": {\n\"cpu\": {\"current\": " << memoryCurrent(false) << ", \"peak\": " << memoryPeak(false) << "},\n";
+	file << "\"gpu\": {\"current\": " << memoryCurrent(true) << ", \"peak\": " << memoryPeak(true) << "},\n";
+	file << "\"subsystems\": [";
+	for (int i = 0; i < MEMORY_SUBSYSTEMS; i++)
+	{
+		MemoryStat stat = memoryStat((MemorySubsystem)i);
+		file << (i ? ",\n" : "\n") << "{\"name\": " << jsonString(stat.name) << ", \"gpu\": " << (stat.gpu ? "true" : "false")
+			 << ", \"current\": " << stat.current << ", \"peak\": " << stat.peak << "}";
+	}
+	file << "],\n";
+
+	GroupMemory all;
+	for (const Group& g : world.groups)
+		groupMemory(g, all);
+
+	file << "\"models\": [";
+	bool first = true;
+	for (const pair<const string, ModelData>& entry : modelCache)
+	{
+		file << (first ? "\n" : ",\n") << "{\"model\": " << jsonString(entry.first) << ", \"vertices\": " << entry.second.vertexCount()
+			 << ", \"cpu\": " << meshBytes(entry.second) << ", \"gpu\": " << bufferBytes(entry.second)
+			 << ", \"uses\": " << all.references[&entry.second] << "}";
+		first = false;
+	}
+	file << "],\n";
+
+	file << "\"groups\": [";
+	for (size_t i = 0; i < world.groups.size(); i++)
+	{
+		GroupMemory memory;
+		groupMemory(world.groups[i], memory);
+
+		size_t meshes, buffers;
+		memory.meshBytes(meshes, buffers);
+		file << (i ? ",\n" : "\n") << "{\"groups\": " << memory.groups << ", \"scene\": " << memory.scene
+			 << ", \"cpu\": " << meshes << ", \"gpu\": " << buffers << "}";
+	}
+	file << "]\n}\n}\n";
+	return !file.fail();
+}
+
+void benchmarkFrame()
+{
+	int now = glutGet(GLUT_ELAPSED_TIME);
+	if (benchmarkStart < 0)
+		benchmarkStart = now;
+	else
+	{
+		benchmarkFrames++;
+		benchmarkVisible += visibleGroups;
+	}
+
+	float elapsed = (now - benchmarkStart) / 1000.0f;
+	if (elapsed >= benchmarkSeconds)
+	{
+		cout << "frames: " << benchmarkFrames << endl;
+		cout << "average frame time: " << (benchmarkFrames > 0 ? elapsed * 1000 / benchmarkFrames : 0) << " ms" << endl;
+		cout << "average visible groups: " << (benchmarkFrames > 0 ? benchmarkVisible / benchmarkFrames : 0) << " of " << totalGroups << endl;
+		cout << "models waiting for upload: " << residencyWaiting << endl;
+
+		int count;
+		const ProfileStat* stats = profileStats(count);
+		for (int i = 0; i < count; i++)
+			cout << stats[i].name << ": " << stats[i].average << " ms" << endl;
+
+		if (!benchJSON.empty() && !writeBenchJSON(benchJSON.c_str(), elapsed))
+			cout << "Could not write " << benchJSON << "!" << endl;
+
+		/*
+		* Without a memory budget every visible model fits, so after a whole
+		* benchmark none may still be waiting; a bundle benchmarked with a
+		* small --upload-budget checks that deferred uploads are retried.
+		*/
+		if (memoryBudget == 0 && residencyWaiting > 0)
+		{
+			cout << "Could not upload every visible model!" << endl;
+			exit(1);
+		}
+		exit(0);
+	}
+
+	// Keep the camera moving at a steady rate, whatever the frame rate
+	static int last = now;
+	orbitCamera(BENCHMARK_ORBIT_SPEED * (now - last) / 1000.0f, 0);
+	last = now;
 }
 
 void renderScene(void)
 {
+	// Also reached on window exposure, when nothing was requested
+	frameDirty = 0;
+	frameScheduled = false;
+	lastFrameTime = glutGet(GLUT_ELAPSED_TIME);
+	uint64_t frameStart = profileNow();
+
 	// clear buffers
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	// set camera
-	glLoadIdentity();
-	gluLookAt(	world.camera.position.x,	world.camera.position.y,	world.camera.position.z,
-				world.camera.lookAt.x,		world.camera.lookAt.y,		world.camera.lookAt.z,
-				world.camera.upVector.x,	world.camera.upVector.y,	world.camera.upVector.z);
-
-	// Aspect currently at 0.0f
-	gluPerspective(world.camera.projection.fov, 0.0f, world.camera.projection.near, world.camera.projection.far);
+	glLoadMatrixf(viewMatrix.m);
 
 	// put drawing instructions here
 	drawAxis();
 
-	glColor3f(0.5, 0.5, 0.5);
-	glBegin(GL_TRIANGLES);
-	for (Point p : vertices)
 	{
-		glVertex3f(p.x, p.y, p.z);
+		PROFILE_SCOPE("draw");
+		for (const Group& g : world.groups)
+			drawGroup(g);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
 	}
-	glEnd();
 
+	endResidencyFrame();
+
+	if (showProfiler)
+		drawProfilerOverlay();
 
 	// End of frame
-	glutSwapBuffers();
+	{
+		PROFILE_SCOPE("swap");
+		glutSwapBuffers();
+	}
+	profileRecord("frame", frameStart, profileNow());
+	profileFrame();
+
+	if (benchmarkSeconds > 0)
+		benchmarkFrame();
+}
+
+void animationTick(int value)
+{
+	// A reloaded scene may have nothing left to animate
+	if (!animated)
+	{
+		animationRunning = false;
+		return;
+	}
+
+	int now = glutGet(GLUT_ELAPSED_TIME);
+	animationAccumulator += now - animationLastTick;
+	animationLastTick = now;
+
+	// Transforms are a function of time alone, so several due steps need a single update
+	if (animationAccumulator >= ANIMATION_STEP_MS)
+	{
+		int steps = animationAccumulator / ANIMATION_STEP_MS;
+		animationAccumulator -= steps * ANIMATION_STEP_MS;
+		animationTime += steps * ANIMATION_STEP_MS / 1000.0;
+
+		updateWorld(false);
+		requestFrame(FRAME_ANIMATION);
+	}
+
+	glutTimerFunc(ANIMATION_STEP_MS - animationAccumulator, animationTick, 0);
+}
+
+void startAnimation()
+{
+	if (animationRunning)
+		return;
+
+	animationRunning = true;
+	animationLastTick = glutGet(GLUT_ELAPSED_TIME);
+	animationAccumulator = 0;
+	glutTimerFunc(ANIMATION_STEP_MS, animationTick, 0);
+}
+
+void modelFiles(const Group& group, set<string>& files)
+{
+	for (const Model& m : group.models)
+	{
+		if (!m.file.empty())
+			files.insert(m.file);
+	}
+	for (const Group& child : group.groups)
+		modelFiles(child, files);
+}
+
+vector<string> watchedFiles()
+{
+	set<string> files;
+	files.insert(sceneFile);
+	for (const Group& g : world.groups)
+		modelFiles(g, files);
+	return vector<string>(files.begin(), files.end());
+}
+
+void sceneModels(const Group& group, vector<const Model*>& models)
+{
+	for (const Model& m : group.models)
+		models.push_back(&m);
+	for (const Group& child : group.groups)
+		sceneModels(child, models);
+}
+
+// Only used on the watcher thread; keeps its buffers, so reloads after the first allocate little
+tinyxml2::XMLDocument reloadDocument;
+
+void reloadFiles(const vector<string>& changed)
+{
+	// Runs on the watcher thread: parses and reads everything before taking the lock
+	Reload result;
+	vector<Model> needed;
+
+	for (const string& file : changed)
+	{
+		if (file == sceneFile)
+		{
+			reloadDocument.SetRetainMemory(true);
+			reloadDocument.SetPoolBlockSize(SCENE_XML_BLOCK);
+			result.scene = loadScene(sceneFile.c_str(), result.world, reloadDocument);
+			if (!result.scene)
+				cout << "Could not reload scene " << sceneFile << "!" << endl;
+		}
+		else
+		{
+			Model m;
+			m.file = file;
+			needed.push_back(m);
+		}
+	}
+
+	// Models of the new scene that aren't loaded yet
+	if (result.scene)
+	{
+		vector<const Model*> models;
+		for (const Group& g : result.world.groups)
+			sceneModels(g, models);
+
+		lock_guard<mutex> lock(reloadMutex);
+		set<string> keys;
+		for (const Model* m : models)
+		{
+			string key = m->key();
+			if (!modelCache.count(key) && !pendingReload.meshes.count(key) && keys.insert(key).second)
+				needed.push_back(*m);
+		}
+	}
+
+	/*
+	* Events only come for closed or renamed files, so a file is complete
+	* unless its writer is still going; a binary model whose vertex count
+	* doesn't fit the file is taken for that. Models that can't be read
+	* keep their old mesh, a later event brings the new one.
+	*/
+	for (const Model& m : needed)
+	{
+		string key = m.key();
+		if (!loadMesh(m, result.meshes[key]))
+		{
+			cout << "Could not load model " << m.file << "!" << endl;
+			result.meshes.erase(key);
+		}
+	}
+
+	lock_guard<mutex> lock(reloadMutex);
+	if (result.scene)
+	{
+		pendingReload.scene = true;
+		pendingReload.world = move(result.world);
+	}
+	for (pair<const string, ModelData>& entry : result.meshes)
+		pendingReload.meshes[entry.first] = move(entry.second);
+	reloadPending = true;
+}
+
+void releasePaths(const Group& group)
+{
+	for (const Transform& t : group.transforms)
+	{
+		if (t.path && t.path->buffer != 0)
+		{
+			memoryRemove(MEMORY_PATH_BUFFERS, t.path->curve.positions.size() * sizeof(vec3));
+			glDeleteBuffers(1, &t.path->buffer);
+			t.path->buffer = 0;
+		}
+	}
+	for (const Group& child : group.groups)
+		releasePaths(child);
+}
+
+void resolveModels(Group& group)
+{
+	for (Model& m : group.models)
+		m.data = &modelCache[m.key()];
+	for (Group& child : group.groups)
+		resolveModels(child);
+}
+
+void applyReload()
+{
+	PROFILE_SCOPE("reload");
+
+	lock_guard<mutex> lock(reloadMutex);
+	if (!reloadPending)
+		return;
+
+	// Changed meshes replace the old ones in place, so models keep pointing to them
+	for (pair<const string, ModelData>& entry : pendingReload.meshes)
+	{
+		// Placeholders of streamed models have nothing accounted yet
+		map<string, ModelData>::iterator cached = modelCache.find(entry.first);
+		bool loaded = cached != modelCache.end() && !cached->second.streaming;
+		ModelData& data = modelCache[entry.first];
+		if (loaded)
+		{
+			memoryRemove(MEMORY_MESHES, meshBytes(data));
+			releaseModel(data);
+		}
+
+		data.mesh = move(entry.second.mesh);
+		data.mapped = move(entry.second.mapped);
+		data.bounds = entry.second.bounds;
+		data.streaming = false;
+		memoryAdd(MEMORY_MESHES, meshBytes(data));
+		if (data.mapped.vertices == NULL)
+			uploadModel(data);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (pendingReload.scene)
+	{
+		for (const Group& g : world.groups)
+			releasePaths(g);
+		memoryRemove(MEMORY_SCENE, sceneBytes(world));
+
+		world.groups = move(pendingReload.world.groups);
+		memoryAdd(MEMORY_SCENE, sceneBytes(world));
+
+		animated = false;
+		for (Group& g : world.groups)
+		{
+			resolveModels(g);
+			animated = animated || g.animated;
+		}
+
+		// Meshes no model uses anymore
+		GroupMemory memory;
+		for (const Group& g : world.groups)
+			groupMemory(g, memory);
+		for (map<string, ModelData>::iterator i = modelCache.begin(); i != modelCache.end(); )
+		{
+			// A streamed mesh that arrives for a dropped model is discarded by streamTick
+			if (memory.references.count(&i->second))
+			{
+				++i;
+				continue;
+			}
+			releaseModel(i->second);
+			memoryRemove(MEMORY_MESHES, meshBytes(i->second));
+			i = modelCache.erase(i);
+		}
+
+		watchFiles(watchedFiles());
+		if (animated)
+			startAnimation();
+	}
+
+	pendingReload = Reload();
+	reloadPending = false;
+
+	updateWorld(true);
+	cullWorld();
+	requestFrame(FRAME_DATA);
+}
+
+void streamLoader()
+{
+	// Jobs are taken in scene order until none is left
+	for (;;)
+	{
+		size_t i = streamNext++;
+		if (i >= streamJobs.size() || streamStop)
+			return;
+
+		StreamJob& job = streamJobs[i];
+		{
+			PROFILE_SCOPE("model load");
+			if (!loadMesh(job.model, job.loaded))
+				cout << "Could not load model " << job.model.file << "!" << endl;
+		}
+
+		lock_guard<mutex> lock(streamMutex);
+		streamReady.push_back(&job);
+	}
+}
+
+void queueModels(Group& group)
+{
+	for (Model& m : group.models)
+	{
+		// Models already queued, or that came with the scene, are only pointed to
+		string key = m.key();
+		map<string, ModelData>::iterator cached = modelCache.find(key);
+		if (cached != modelCache.end())
+		{
+			m.data = &cached->second;
+			continue;
+		}
+
+		ModelData& data = modelCache[key];
+		m.data = &data;
+		data.streaming = true;
+
+		StreamJob job;
+		job.model = m;
+		job.key = key;
+		streamJobs.push_back(move(job));
+	}
+
+	for (Group& child : group.groups)
+		queueModels(child);
+}
+
+void streamModels()
+{
+	for (Group& g : world.groups)
+		queueModels(g);
+
+	unsigned int threads = min((unsigned int)STREAM_THREADS, max(1u, thread::hardware_concurrency()));
+	for (unsigned int i = 0; i < threads; i++)
+		streamThreads.emplace_back(streamLoader);
+}
+
+void stopStreaming()
+{
+	// Loaders write into the jobs, they must be done before exit tears them down
+	streamStop = true;
+	for (thread& t : streamThreads)
+		t.join();
+	streamThreads.clear();
+}
+
+void refreshBounds(Group& group)
+{
+	groupBounds(group);
+	for (Group& child : group.groups)
+		refreshBounds(child);
+}
+
+void streamTick(int value)
+{
+	PROFILE_SCOPE("stream");
+
+	vector<StreamJob*> ready;
+	{
+		lock_guard<mutex> lock(streamMutex);
+		ready.swap(streamReady);
+	}
+
+	// Uploads within the budget, the rest waits for the next frame
+	size_t bytes = 0, uploaded = 0;
+	for (; uploaded < ready.size() && (uploaded == 0 || bytes + ready[uploaded]->loaded.mesh.bytes() <= uploadBudget); uploaded++)
+	{
+		StreamJob& job = *ready[uploaded];
+		bytes += job.loaded.mesh.bytes();
+
+		// A hot reload may have replaced the placeholder, or dropped it, meanwhile
+		map<string, ModelData>::iterator cached = modelCache.find(job.key);
+		if (cached != modelCache.end() && cached->second.streaming)
+		{
+			ModelData& data = cached->second;
+			data.mesh = move(job.loaded.mesh);
+			data.mapped = move(job.loaded.mapped);
+			data.bounds = job.loaded.bounds;
+			data.streaming = false;
+			memoryAdd(MEMORY_MESHES, meshBytes(data));
+			if (data.mapped.vertices == NULL)
+				uploadModel(data);
+		}
+		job.loaded = ModelData();
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	streamUploaded += uploaded;
+
+	if (uploaded < ready.size())
+	{
+		lock_guard<mutex> lock(streamMutex);
+		streamReady.insert(streamReady.begin(), ready.begin() + uploaded, ready.end());
+	}
+
+	bool done = streamUploaded == streamJobs.size();
+	if (uploaded > 0)
+	{
+		// Group bounds depend on every mesh, refreshing them is not worth it after each one
+		int now = glutGet(GLUT_ELAPSED_TIME);
+		if (done || now - streamBoundsTime >= STREAM_BOUNDS_MS)
+		{
+			for (Group& g : world.groups)
+				refreshBounds(g);
+			cullWorld();
+			streamBoundsTime = now;
+		}
+		requestFrame(FRAME_DATA);
+	}
+
+	if (!done)
+		glutTimerFunc(STREAM_POLL_MS, streamTick, 0);
+}
+
+string sceneCacheFile(uint64_t hash)
+{
+	/*
+	* The cache is off unless SCENE_CACHE_DIR names a directory for it
+	* (.scene_cache is the usual choice). Every version of a scene XML
+	* adds an entry and none is ever pruned, so the directory has to be
+	* deleted by hand to reclaim its space.
+	*/
+	const char* dir = getenv("SCENE_CACHE_DIR");
+	if (dir == NULL || *dir == 0)
+		return "";
+	filesystem::path directory = dir;
+
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.scene", (unsigned long long)hash);
+	return (directory / name).string();
+}
+
+void writeSceneCache(const string& cache, uint64_t hash)
+{
+	// writeBundle renames the finished file into place, a concurrent run never reads a partial one
+	error_code ec;
+	filesystem::create_directories(filesystem::path(cache).parent_path(), ec);
+	writeBundle(cache.c_str(), world, hash, false);
+}
+
+void loadWorld(char* fileName)
+{
+	/*
+	* Bundles carry their models along. With the scene cache on, a scene
+	* XML seen before is read from it, a scene graph only bundle made the
+	* first time it was parsed and named after the hash of its contents
+	* and the reader version.
+	*/
+	sceneBundle = isBundle(fileName);
+
+	uint64_t hash = 0, source = 0;
+	string cache;
+	if (!sceneBundle && fileHash(fileName, hash))
+	{
+		// The reader version goes into the key too, one more FNV-1a step
+		hash = (hash ^ SCENE_READER_VERSION) * 1099511628211ull;
+		cache = sceneCacheFile(hash);
+	}
+
+	if (sceneBundle)
+	{
+		if (!loadBundle(fileName, world, source))
+			cout << "Could not load bundle " << fileName << "!" << endl;
+	}
+	else if (cache.empty() || !isBundle(cache.c_str()) || !loadBundle(cache.c_str(), world, source) || source != hash)
+	{
+		// Whatever a stale or broken cache file left is replaced
+		world = World();
+		if (loadXML(fileName) && !cache.empty())
+			writeSceneCache(cache, hash);
+		return;
+	}
+
+	for (const Group& g : world.groups)
+		animated = animated || g.animated;
+	memoryAdd(MEMORY_SCENE, sceneBytes(world));
+}
+
+void reloadTick(int value)
+{
+	applyReload();
+	glutTimerFunc(RELOAD_POLL_MS, reloadTick, 0);
 }
 
 void regular_keys(unsigned char key, int x, int y)
@@ -340,11 +1289,90 @@ void regular_keys(unsigned char key, int x, int y)
 			polygonMode = 0;
 			glPolygonMode(GL_FRONT, GL_FILL);
 		}
+		requestFrame(FRAME_SETTINGS);
+		break;
+	case 'c':
+		cameraMode = cameraMode == CAMERA_ORBIT ? CAMERA_FPS : CAMERA_ORBIT;
+		break;
+	case 'f':
+		showProfiler = !showProfiler;
+		requestFrame(FRAME_SETTINGS);
+		break;
+	case 'm':
+		printMemoryReport();
+		break;
+	case '+':
+		zoomCamera(0.9f);
+		break;
+	case '-':
+		zoomCamera(1.1f);
+		break;
+	case 'w':
+		if (cameraMode == CAMERA_FPS) moveCamera(1, 0);
+		break;
+	case 's':
+		if (cameraMode == CAMERA_FPS) moveCamera(-1, 0);
+		break;
+	case 'a':
+		if (cameraMode == CAMERA_FPS) moveCamera(0, -1);
+		break;
+	case 'd':
+		if (cameraMode == CAMERA_FPS) moveCamera(0, 1);
 		break;
 	}
-	glutPostRedisplay();
 }
 
+void special_keys(int key, int x, int y)
+{
+	float dx = 0, dy = 0;
+	switch (key) {
+	case GLUT_KEY_LEFT:		dx = -5; break;
+	case GLUT_KEY_RIGHT:	dx = 5; break;
+	case GLUT_KEY_UP:		dy = 5; break;
+	case GLUT_KEY_DOWN:		dy = -5; break;
+	default:
+		return;
+	}
+
+	if (cameraMode == CAMERA_ORBIT)
+		orbitCamera(dx, dy);
+	else
+		lookCamera(dx, dy);
+}
+
+void mouse_button(int button, int state, int x, int y)
+{
+	// Wheel events come as buttons 3 (up) and 4 (down) on freeglut
+	if (state == GLUT_DOWN && (button == 3 || button == 4))
+	{
+		zoomCamera(button == 3 ? 0.9f : 1.1f);
+		return;
+	}
+
+	mouseButton = state == GLUT_DOWN ? button : -1;
+	mouseX = x;
+	mouseY = y;
+}
+
+void mouse_motion(int x, int y)
+{
+	int dx = x - mouseX;
+	int dy = y - mouseY;
+	mouseX = x;
+	mouseY = y;
+
+	if (mouseButton == GLUT_LEFT_BUTTON)
+	{
+		if (cameraMode == CAMERA_ORBIT)
+			orbitCamera(-dx * 0.5f, dy * 0.5f);
+		else
+			lookCamera(dx * 0.2f, -dy * 0.2f);
+	}
+	else if (mouseButton == GLUT_RIGHT_BUTTON && dy != 0)
+	{
+		zoomCamera(powf(1.01f, (float)dy));
+	}
+}
 
 int main(int argc, char** argv)
 {
@@ -355,10 +1383,47 @@ int main(int argc, char** argv)
 	}
 	else
 	{
-		loadXML(argv[1]);
+		sceneFile = argv[1];
+		loadWorld(argv[1]);
 	}
 
-	loadModels();
+	// Optional settings after the scene file, anything else is left to GLUT
+	for (int i = 2; i < argc; i++)
+	{
+		string option = argv[i];
+		if (option == "--max-fps" && i + 1 < argc)
+			frameRateCap = stoi(argv[++i]);
+		else if (option == "--benchmark" && i + 1 < argc)
+			benchmarkSeconds = stof(argv[++i]);
+		else if (option == "--profile-csv" && i + 1 < argc)
+			profileCSV = argv[++i];
+		else if (option == "--profile-trace" && i + 1 < argc)
+			profileTrace = argv[++i];
+		else if (option == "--bench-json" && i + 1 < argc)
+			benchJSON = argv[++i];
+		else if (option == "--watch")
+			watchReload = true;
+		else if (option == "--sync-load")
+			syncLoad = true;
+		else if (option == "--upload-budget" && i + 1 < argc)
+			uploadBudget = (size_t)(stof(argv[++i]) * 1024 * 1024);
+		else if (option == "--memory-budget" && i + 1 < argc)
+			memoryBudget = (size_t)(stof(argv[++i]) * 1024 * 1024);
+		else if (option.compare(0, 2, "--") == 0)
+			cout << "Unknown option " << option << "!" << endl;
+	}
+
+	mapModels = memoryBudget > 0;
+
+	// Benchmarks measure the whole scene, so they never stream
+	if (syncLoad || benchmarkSeconds > 0)
+		loadModels();
+	else
+		streamModels();
+
+	// Profiles are written however the engine exits, once the loaders are stopped
+	atexit(writeProfiles);
+	atexit(stopStreaming);
 
 	// put GLUTs init here
 	glutInit(&argc, argv);
@@ -367,18 +1432,53 @@ int main(int argc, char** argv)
 	glutInitWindowSize(world.window.width, world.window.height);
 	glutCreateWindow("CG@DI");
 
+#ifdef _WIN32
+	glewInit();
+#endif
+
 	// put callback registry here
 	glutReshapeFunc(changeSize);
 	glutDisplayFunc(renderScene);
 
 	// Keyboard Functions
 	glutKeyboardFunc(regular_keys);
+	glutSpecialFunc(special_keys);
+
+	// Mouse Functions
+	glutMouseFunc(mouse_button);
+	glutMotionFunc(mouse_motion);
+
+	cameraStep = fmaxf(0.01f, length(world.camera.position - world.camera.lookAt) * 0.02f);
+
+	// The animation clock only runs when something moves; static scenes sit idle
+	updateWorld(true);
+	if (animated)
+		startAnimation();
 
 	// some OpenGL settings
 	glEnable(GL_DEPTH_TEST);
 	glEnable(GL_CULL_FACE);
 	glPolygonMode(GL_FRONT, GL_LINE);
 	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glEnableClientState(GL_VERTEX_ARRAY);
+
+	uploadModels();
+	if (!streamJobs.empty())
+		glutTimerFunc(0, streamTick, 0);
+
+	if (watchReload && sceneBundle)
+		cout << "Bundles are not watched, use the scene XML instead!" << endl;
+	else if (watchReload)
+	{
+		if (watchStart(watchedFiles(), reloadFiles))
+		{
+			// A reload in progress reads the scene and model cache, it must be done before exit tears them down
+			atexit(watchStop);
+			glutTimerFunc(RELOAD_POLL_MS, reloadTick, 0);
+		}
+		else
+			cout << "Could not watch the scene files!" << endl;
+	}
 
 	// enter GLUTs main cycle
 	glutMainLoop();
@@ -0,0 +1,88 @@
+#include <atomic>
+#include <stdio.h>
+#include "memstats.h"
+
+using namespace std;
+
+class MemoryCounter
+{
+public:
+	atomic<size_t> current;
+	atomic<size_t> peak;
+
+	MemoryCounter() : current(0), peak(0) {};
+
+	void add(size_t bytes)
+	{
+		size_t now = current.fetch_add(bytes) + bytes;
+		size_t highest = peak.load();
+		while (now > highest && !peak.compare_exchange_weak(highest, now))
+			;
+	}
+
+	void remove(size_t bytes)
+	{
+		current.fetch_sub(bytes);
+	}
+};
+
+static const char* names[MEMORY_SUBSYSTEMS] = {
+	"meshes", "scene", "xml", "profiler", "vertex buffers", "path buffers"
+};
+
+static const bool gpu[MEMORY_SUBSYSTEMS] = {
+	false, false, false, false, true, true
+};
+
+static MemoryCounter counters[MEMORY_SUBSYSTEMS];
+static MemoryCounter totals[2];		// CPU, GPU
+
+void memoryAdd(MemorySubsystem subsystem, size_t bytes)
+{
+	counters[subsystem].add(bytes);
+	totals[gpu[subsystem]].add(bytes);
+}
+
+void memoryRemove(MemorySubsystem subsystem, size_t bytes)
+{
+	counters[subsystem].remove(bytes);
+	totals[gpu[subsystem]].remove(bytes);
+}
+
+MemoryStat memoryStat(MemorySubsystem subsystem)
+{
+	MemoryStat stat;
+	stat.name = names[subsystem];
+	stat.gpu = gpu[subsystem];
+	stat.current = counters[subsystem].current.load();
+	stat.peak = counters[subsystem].peak.load();
+	return stat;
+}
+
+size_t memoryCurrent(bool isGpu)
+{
+	return totals[isGpu].current.load();
+}
+
+size_t memoryPeak(bool isGpu)
+{
+	return totals[isGpu].peak.load();
+}
+
+const char* memoryFormat(size_t bytes, char* text, size_t size)
+{
+	const char* units[] = { "B", "KB", "MB", "GB" };
+	double value = (double)bytes;
+	int unit = 0;
+	while (value >= 1024 && unit < 3)
+	{
+		value /= 1024;
+		unit++;
+	}
+
+	if (unit == 0)
+		snprintf(text, size, "%zu B", bytes);
+	else
+		snprintf(text, size, "%.1f %s", value, units[unit]);
+	return text;
+}
@@ -0,0 +1,48 @@
+#ifndef MEMSTATS_H
+#define MEMSTATS_H
+
+#include <stddef.h>
+
+/*
+* Memory accounting.
+*
+* Every subsystem reports the bytes it allocates and frees, and current and
+* peak usage are kept per subsystem and for CPU and GPU memory as a whole.
+* Counters are atomic, so loader threads may report as well. Finer detail
+* (per model, per group) is derived from the scene itself by the engine.
+*/
+
+enum MemorySubsystem
+{
+	MEMORY_MESHES,			// vertex arrays of loaded and generated models
+	MEMORY_SCENE,			// groups, transforms, models and curve tables
+	MEMORY_XML,				// tinyxml2 documents while a scene is parsed
+	MEMORY_PROFILER,		// profiler ring buffers
+	MEMORY_VERTEX_BUFFERS,	// GPU copies of the meshes
+	MEMORY_PATH_BUFFERS,	// GPU line strips of animation paths
+	MEMORY_SUBSYSTEMS
+};
+
+class MemoryStat
+{
+public:
+	const char* name;
+	bool gpu;			// bytes live in GPU memory
+	size_t current;
+	size_t peak;
+};
+
+void memoryAdd(MemorySubsystem subsystem, size_t bytes);
+void memoryRemove(MemorySubsystem subsystem, size_t bytes);
+
+// Snapshot of a subsystem's counters
+MemoryStat memoryStat(MemorySubsystem subsystem);
+
+// Totals over every CPU or GPU subsystem
+size_t memoryCurrent(bool gpu);
+size_t memoryPeak(bool gpu);
+
+// Human readable size ("12.3 MB") written to text, which is returned
+const char* memoryFormat(size_t bytes, char* text, size_t size);
+
+#endif
@@ -0,0 +1,178 @@
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <cstring>
+#include "profiler.h"
+#include "memstats.h"
+
+using namespace std;
+
+class ProfileBuffer
+{
+public:
+	ProfileEvent events[PROFILE_RING_SIZE];
+	atomic<uint64_t> count;	// events ever recorded, the ring holds the last PROFILE_RING_SIZE
+	int thread;				// small sequential id, 0 for the first (main) thread
+
+	ProfileBuffer(int id) : count(0), thread(id) {};
+};
+
+static const chrono::steady_clock::time_point profileEpoch = chrono::steady_clock::now();
+
+static mutex buffersMutex;
+static vector<ProfileBuffer*> buffers;
+static thread_local ProfileBuffer* threadBuffer = NULL;
+
+static atomic<uint32_t> frameIndex(0);
+static ProfileStat stats[PROFILE_MAX_STATS];
+static int statCount = 0;
+
+uint64_t profileNow()
+{
+	return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - profileEpoch).count();
+}
+
+static ProfileBuffer* buffer()
+{
+	// First event of a thread: the only allocation the profiler ever does for it
+	if (threadBuffer == NULL)
+	{
+		lock_guard<mutex> lock(buffersMutex);
+		threadBuffer = new ProfileBuffer((int)buffers.size());
+		buffers.push_back(threadBuffer);
+		memoryAdd(MEMORY_PROFILER, sizeof(ProfileBuffer));
+	}
+	return threadBuffer;
+}
+
+void profileRecord(const char* name, uint64_t start, uint64_t end)
+{
+	ProfileBuffer* b = buffer();
+	uint64_t n = b->count.load(memory_order_relaxed);
+	ProfileEvent& e = b->events[n % PROFILE_RING_SIZE];
+	e.name = name;
+	e.start = start;
+	e.end = end;
+	e.frame = frameIndex.load(memory_order_relaxed);
+	b->count.store(n + 1, memory_order_release);
+
+	// Per frame totals are only kept for the thread that draws the frames
+	if (b->thread != 0)
+		return;
+
+	int i = 0;
+	while (i < statCount && stats[i].name != name)
+		i++;
+	if (i == statCount)
+	{
+		if (statCount == PROFILE_MAX_STATS)
+			return;
+		stats[statCount].name = name;
+		stats[statCount].current = 0;
+		stats[statCount].average = 0;
+		stats[statCount].calls = 0;
+		statCount++;
+	}
+	stats[i].current += end - start;
+	stats[i].calls++;
+}
+
+void profileFrame()
+{
+	for (int i = 0; i < statCount; i++)
+	{
+		// Exponential moving average over roughly the last 20 frames
+		double ms = stats[i].current / 1e6;
+		stats[i].average = stats[i].average * 0.95 + ms * 0.05;
+		stats[i].current = 0;
+		stats[i].calls = 0;
+	}
+	frameIndex++;
+}
+
+uint32_t profileFrameIndex()
+{
+	return frameIndex.load();
+}
+
+const ProfileStat* profileStats(int& count)
+{
+	count = statCount;
+	return stats;
+}
+
+double profileAverage(const char* name)
+{
+	for (int i = 0; i < statCount; i++)
+	{
+		if (strcmp(stats[i].name, name) == 0)
+			return stats[i].average;
+	}
+	return 0;
+}
+
+// Snapshot of all buffered events, oldest first per thread
+static void collect(vector<pair<int, ProfileEvent>>& events)
+{
+	lock_guard<mutex> lock(buffersMutex);
+	for (ProfileBuffer* b : buffers)
+	{
+		uint64_t n = b->count.load(memory_order_acquire);
+		uint64_t first = n > PROFILE_RING_SIZE ? n - PROFILE_RING_SIZE : 0;
+		for (uint64_t i = first; i < n; i++)
+			events.push_back(make_pair(b->thread, b->events[i % PROFILE_RING_SIZE]));
+	}
+	sort(events.begin(), events.end(), [](const pair<int, ProfileEvent>& a, const pair<int, ProfileEvent>& b)
+	{
+		return a.second.start < b.second.start;
+	});
+}
+
+bool profileWriteCSV(const char* fileName)
+{
+	ofstream file(fileName);
+	if (!file)
+		return false;
+
+	vector<pair<int, ProfileEvent>> events;
+	collect(events);
+
+	// Nanosecond times as microseconds, in full however long the run
+	file << fixed << setprecision(3);
+	file << "thread,frame,name,start_us,duration_us\n";
+	for (const pair<int, ProfileEvent>& e : events)
+	{
+		file << e.first << "," << e.second.frame << "," << e.second.name << ","
+			 << e.second.start / 1000.0 << "," << (e.second.end - e.second.start) / 1000.0 << "\n";
+	}
+	return !file.fail();
+}
+
+bool profileWriteTrace(const char* fileName)
+{
+	// Chrome trace event format, complete ("X") events in microseconds
+	ofstream file(fileName);
+	if (!file)
+		return false;
+
+	vector<pair<int, ProfileEvent>> events;
+	collect(events);
+
+	file << fixed << setprecision(3);
+	file << "{\"traceEvents\":[";
+	bool first = true;
+	for (const pair<int, ProfileEvent>& e : events)
+	{
+		file << (first ? "\n" : ",\n");
+		file << "{\"name\":\"" << e.second.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.first
+			 << ",\"ts\":" << e.second.start / 1000.0 << ",\"dur\":" << (e.second.end - e.second.start) / 1000.0
+			 << ",\"args\":{\"frame\":" << e.second.frame << "}}";
+		first = false;
+	}
+	file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+	return !file.fail();
+}
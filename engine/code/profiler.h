@@ -0,0 +1,75 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+
+/*
+* Lightweight scoped timers.
+*
+* PROFILE_SCOPE("name") times the rest of the enclosing block. Every thread
+* records into its own fixed size ring buffer (allocated the first time the
+* thread records anything), so timing a scope takes two clock reads and a
+* store, with no locks or allocations. Names must be string literals or
+* otherwise outlive the profiler, only the pointer is kept.
+*
+* Besides the raw events, the main thread keeps a smoothed per frame
+* duration of every scope name, which the on-screen overlay shows.
+*/
+
+#define PROFILE_RING_SIZE	(1 << 16)	// events kept per thread, oldest overwritten first
+#define PROFILE_MAX_STATS	32			// distinct scope names tracked for the overlay
+
+class ProfileEvent
+{
+public:
+	const char* name;
+	uint64_t start;		// nanoseconds since the profiler started
+	uint64_t end;
+	uint32_t frame;		// frame the event was recorded in
+};
+
+class ProfileStat
+{
+public:
+	const char* name;
+	uint64_t current;	// nanoseconds spent in the scope during the current frame
+	double average;		// smoothed milliseconds per frame
+	uint32_t calls;		// calls during the current frame
+};
+
+// Nanoseconds since the profiler started, from the steady clock
+uint64_t profileNow();
+
+void profileRecord(const char* name, uint64_t start, uint64_t end);
+
+// Closes the current frame: folds per frame totals into the averages
+void profileFrame();
+
+// Current frame number
+uint32_t profileFrameIndex();
+
+// Stats of the scopes seen on the main thread, count set to the number of entries
+const ProfileStat* profileStats(int& count);
+
+// Smoothed milliseconds per frame spent in name, 0 if never seen
+double profileAverage(const char* name);
+
+// Exports every recorded event still in the ring buffers, false if the file can't be written
+bool profileWriteCSV(const char* fileName);
+bool profileWriteTrace(const char* fileName);
+
+class ProfileScope
+{
+public:
+	const char* name;
+	uint64_t start;
+
+	ProfileScope(const char* scopeName) : name(scopeName), start(profileNow()) {};
+	~ProfileScope() { profileRecord(name, start, profileNow()); }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+
+#endif
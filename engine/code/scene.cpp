@@ -0,0 +1,764 @@
+#include <iostream>
+#include <stdio.h>
+#include <cmath>
+#include <filesystem>
+#include "tinyxml2/tinyxml2.h"
+#include "xmlstream.h"
+#include "primitives.h"
+#include "profiler.h"
+#include "memstats.h"
+#include "scene.h"
+
+using namespace std;
+using namespace tinyxml2;
+
+map<string, ModelData> modelCache;
+World world;
+
+// True when some transform depends on time, so the animation clock must run
+bool animated = false;
+
+bool mapModels = false;
+
+// XML attributes of each procedural model, in the order buildPrimitive expects them
+map<string, vector<string>> primitiveAttributes = {
+	{ "plane",		{ "length", "divisions" } },
+	{ "box",		{ "length", "divisions" } },
+	{ "sphere",		{ "radius", "slices", "stacks" } },
+	{ "cone",		{ "radius", "height", "slices", "stacks" } },
+	{ "cylinder",	{ "radius", "height", "slices" } }
+};
+
+string Model::key() const
+{
+	if (primitive.empty())
+		return file;
+
+	string k = "primitive:" + primitive;
+	char value[32];
+	for (float p : params)
+	{
+		snprintf(value, sizeof(value), " %.9g", p);
+		k += value;
+	}
+	return k;
+}
+
+mat4 Transform::matrix(double seconds) const
+{
+	/*
+	* Fraction of the lap or turn done, reduced in double: a float clock
+	* steps by more than a frame after a few days of running.
+	*/
+	float lap = time > 0 ? (float)(fmod(seconds, (double)time) / time) : 0;
+
+	switch (type)
+	{
+	case TRANSLATE:
+		if (path)
+		{
+			vec3 position, tangent;
+			path->curve.sample(lap, position, tangent);
+			mat4 m = mat4::translate(position.x, position.y, position.z);
+
+			if (align)
+			{
+				/*
+				* Rotation taking the X axis to the tangent, keeping the
+				* group as upright as the path allows
+				*/
+				vec3 z = cross(tangent, vec3(0, 1, 0));
+				if (length(z) < 1e-6f)
+					z = vec3(0, 0, 1);
+				z = normalize(z);
+				vec3 y = cross(z, tangent);
+
+				mat4 r;
+				r.m[0] = tangent.x; r.m[1] = tangent.y; r.m[2] = tangent.z;
+				r.m[4] = y.x;		r.m[5] = y.y;		r.m[6] = y.z;
+				r.m[8] = z.x;		r.m[9] = z.y;		r.m[10] = z.z;
+				m = m * r;
+			}
+			return m;
+		}
+		return mat4::translate(vector.x, vector.y, vector.z);
+
+	case ROTATE:
+		if (time > 0)
+			return mat4::rotate(360.0f * lap, vector.x, vector.y, vector.z);
+		return mat4::rotate(angle, vector.x, vector.y, vector.z);
+
+	case SCALE:
+		return mat4::scale(vector.x, vector.y, vector.z);
+	}
+	return mat4();
+}
+
+/*
+* The readers of single elements take an XMLElement of the document or
+* the XMLStream positioned on the element, which answer Name() and
+* Attribute() alike.
+*/
+
+template <class Element>
+float floatAttribute(Element* pElement, const char* name, float value)
+{
+	// Optional attributes keep the given default when absent or not a number
+	const char* attribute = pElement->Attribute(name);
+	float number;
+	return attribute != NULL && XMLUtil::ToFloat(attribute, &number) ? number : value;
+}
+
+// The x, y and z attributes, each keeping the given default like floatAttribute
+template <class Element>
+vec3 vectorAttribute(Element* pElement, float value)
+{
+	return vec3(floatAttribute(pElement, "x", value), floatAttribute(pElement, "y", value), floatAttribute(pElement, "z", value));
+}
+
+// Document elements are read in one pass over their attributes
+vec3 vectorAttribute(XMLElement* pElement, float value)
+{
+	float xyz[3] = { value, value, value };
+	pElement->QueryFloatTriple("x", "y", "z", xyz);
+	return vec3(xyz[0], xyz[1], xyz[2]);
+}
+
+template <class Element>
+Window loadWindow(Element* pWindow)
+{
+	return Window(stoi(pWindow->Attribute("width")), stoi(pWindow->Attribute("height")));
+}
+
+template <class Element>
+Projection loadProjection(Element* pProjection)
+{
+	Projection projection;
+	float fov = floatAttribute(pProjection, "fov", projection.fov);
+	float near = floatAttribute(pProjection, "near", projection.near);
+	float far = floatAttribute(pProjection, "far", projection.far);
+	return Projection(fov, near, far);
+}
+
+// The attributes of a transform; the points of a timed translation are left to loadPath
+template <class Element>
+bool readTransform(Element* pTransform, Transform& transform)
+{
+	string name = pTransform->Name();
+	vec3 v = vectorAttribute(pTransform, 0);
+
+	if (name == "translate")
+	{
+		transform.type = Transform::TRANSLATE;
+		transform.vector = v;
+		transform.time = floatAttribute(pTransform, "time", 0);
+
+		if (transform.time > 0)
+		{
+			const char* align = pTransform->Attribute("align");
+			transform.align = align != NULL && string(align) == "true";
+		}
+	}
+	else if (name == "rotate")
+	{
+		transform.type = Transform::ROTATE;
+		transform.vector = v;
+		transform.angle = floatAttribute(pTransform, "angle", 0);
+		transform.time = floatAttribute(pTransform, "time", 0);
+	}
+	else if (name == "scale")
+	{
+		transform.type = Transform::SCALE;
+		transform.vector = vectorAttribute(pTransform, 1);
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+// True for translations along a path, which need their points
+bool timedTranslate(const Transform& transform)
+{
+	return transform.type == Transform::TRANSLATE && transform.time > 0;
+}
+
+template <class Element>
+vec3 loadPoint(Element* pPoint)
+{
+	return vectorAttribute(pPoint, 0);
+}
+
+bool loadPath(Transform& transform, const vector<vec3>& points)
+{
+	// Timed translation along the closed curve through its points
+	if (points.size() < 4)
+	{
+		cout << "Timed translate requires at least 4 points!" << endl;
+		return false;
+	}
+
+	transform.path = make_shared<Path>();
+	transform.path->curve = Curve(points);
+	transform.path->curve.build();
+	return true;
+}
+
+bool loadTransform(XMLElement* pTransform, Transform& transform)
+{
+	if (!readTransform(pTransform, transform))
+		return false;
+	if (!timedTranslate(transform))
+		return true;
+
+	vector<vec3> points;
+	XMLElement* pPoint = pTransform->FirstChildElement("point");
+	while (pPoint)
+	{
+		points.push_back(loadPoint(pPoint));
+		pPoint = pPoint->NextSiblingElement("point");
+	}
+	return loadPath(transform, points);
+}
+
+template <class Element>
+bool loadModel(Element* pModel, Model& model)
+{
+	const char* file = pModel->Attribute("file");
+	const char* primitive = pModel->Attribute("primitive");
+
+	if (file != NULL)
+	{
+		model.file = file;
+	}
+	else if (primitive != NULL && primitiveAttributes.count(primitive))
+	{
+		// Procedural model, generated in memory by loadModels
+		model.primitive = primitive;
+		for (const string& name : primitiveAttributes[primitive])
+		{
+			const char* value = pModel->Attribute(name.c_str());
+			float param;
+			if (value == NULL || !XMLUtil::ToFloat(value, &param))
+			{
+				cout << "Missing attribute " << name << " for " << primitive << " model!" << endl;
+				model.primitive.clear();
+				break;
+			}
+			model.params.push_back(param);
+		}
+	}
+	else if (primitive != NULL)
+	{
+		cout << "Unknown primitive " << primitive << "!" << endl;
+	}
+
+	return !model.file.empty() || !model.primitive.empty();
+}
+
+void loadGroup(XMLElement* pGroup, Group& group)
+{
+	/*
+	* Transforms can be direct children of the group or wrapped in a
+	* <transform> element; either way they apply in document order.
+	*/
+	for (XMLElement* pChild = pGroup->FirstChildElement(); pChild; pChild = pChild->NextSiblingElement())
+	{
+		string name = pChild->Name();
+
+		if (name == "transform")
+		{
+			for (XMLElement* pTransform = pChild->FirstChildElement(); pTransform; pTransform = pTransform->NextSiblingElement())
+			{
+				Transform transform;
+				if (loadTransform(pTransform, transform))
+					group.transforms.push_back(transform);
+			}
+		}
+		else if (name == "translate" || name == "rotate" || name == "scale")
+		{
+			Transform transform;
+			if (loadTransform(pChild, transform))
+				group.transforms.push_back(transform);
+		}
+		else if (name == "models")
+		{
+			// Run through every model element
+			XMLElement* pModel = pChild->FirstChildElement("model");
+			while (pModel)
+			{
+				// Add model to models vector in group
+				Model model;
+				if (loadModel(pModel, model))
+					group.models.push_back(model);
+
+				// Change pointer to next model element
+				pModel = pModel->NextSiblingElement("model");
+			}
+		}
+		else if (name == "group")
+		{
+			// Nested group
+			Group child;
+			loadGroup(pChild, child);
+			group.groups.push_back(child);
+		}
+	}
+}
+
+void prepareGroup(Group& group)
+{
+	// Static transforms are multiplied once here, timed ones on every update
+	group.local = mat4();
+	group.timed = false;
+	for (const Transform& t : group.transforms)
+	{
+		if (t.time > 0)
+			group.timed = true;
+		group.local = group.local * t.matrix(0);
+	}
+
+	group.animated = group.timed;
+	for (Group& child : group.groups)
+	{
+		prepareGroup(child);
+		group.animated = group.animated || child.animated;
+	}
+}
+
+size_t meshBytes(const ModelData& data)
+{
+	return sizeof(ModelData) + data.mesh.vertices.capacity() * sizeof(Point);
+}
+
+size_t bufferBytes(const ModelData& data)
+{
+	return data.bufferSize;
+}
+
+size_t groupBytes(const Group& group)
+{
+	// The group's own storage; nested groups and shared meshes are counted separately
+	size_t bytes = group.transforms.capacity() * sizeof(Transform)
+		+ group.models.capacity() * sizeof(Model)
+		+ group.groups.capacity() * sizeof(Group);
+
+	for (const Transform& t : group.transforms)
+	{
+		if (t.path)
+		{
+			const Curve& c = t.path->curve;
+			bytes += sizeof(Path) + (c.points.capacity() + c.positions.capacity() + c.tangents.capacity()) * sizeof(vec3);
+		}
+	}
+	for (const Model& m : group.models)
+		bytes += m.file.capacity() + m.primitive.capacity() + m.params.capacity() * sizeof(float);
+	return bytes;
+}
+
+void GroupMemory::meshBytes(size_t& cpu, size_t& gpu) const
+{
+	cpu = 0;
+	gpu = 0;
+	for (const pair<const ModelData* const, int>& r : references)
+	{
+		cpu += ::meshBytes(*r.first);
+		gpu += bufferBytes(*r.first);
+	}
+}
+
+void groupMemory(const Group& group, GroupMemory& memory)
+{
+	memory.groups++;
+	memory.scene += groupBytes(group);
+	for (const Model& m : group.models)
+	{
+		if (m.data != NULL)
+			memory.references[m.data]++;
+	}
+
+	for (const Group& child : group.groups)
+		groupMemory(child, memory);
+}
+
+size_t sceneBytes(const World& scene)
+{
+	GroupMemory memory;
+	for (const Group& g : scene.groups)
+		groupMemory(g, memory);
+	return sizeof(World) + scene.groups.capacity() * sizeof(Group) + memory.scene;
+}
+
+// What the element being read is to the scene, one per open element
+enum StreamContext
+{
+	STREAM_IGNORED,
+	STREAM_ROOT,
+	STREAM_CAMERA,
+	STREAM_GROUP,
+	STREAM_TRANSFORMS,		// <transform> wrapper of a group's transforms
+	STREAM_MODELS,
+	STREAM_PATH				// timed translate, reading its points
+};
+
+bool streamScene(const char* fileName, World& scene)
+{
+	PROFILE_SCOPE("stream xml");
+
+	XMLStream xml;
+	if (!xml.open(fileName))
+		return false;
+
+	// Only the stream buffer is held while reading, not a document of the whole file
+	size_t xmlBytes = xml.memoryUsage();
+	memoryAdd(MEMORY_XML, xmlBytes);
+
+	/*
+	* Everything is built aside and only handed to scene once the file
+	* turns out well formed, as loading the document would have failed
+	* before anything was read. Groups are built innermost last and move
+	* into their parent (or the top level, prepared) when they end.
+	*/
+	World read;
+	vector<Group> open;
+	vector<StreamContext> contexts;
+	bool rootSeen = false, windowSeen = false, cameraSeen = false;
+	bool positionSeen = false, lookAtSeen = false, upSeen = false, projectionSeen = false;
+	vec3 position, lookAt, upVector;
+	Projection projection;
+	Transform path;
+	vector<vec3> points;
+
+	XMLStreamEvent event;
+	while ((event = xml.next()) == XML_STREAM_START || event == XML_STREAM_END)
+	{
+		if (event == XML_STREAM_END)
+		{
+			StreamContext context = contexts.back();
+			contexts.pop_back();
+
+			if (context == STREAM_CAMERA)
+			{
+				read.camera = Camera(position, lookAt, upVector, projection);
+			}
+			else if (context == STREAM_PATH)
+			{
+				if (loadPath(path, points))
+					open.back().transforms.push_back(path);
+			}
+			else if (context == STREAM_GROUP)
+			{
+				Group group = move(open.back());
+				open.pop_back();
+				if (!open.empty())
+				{
+					open.back().groups.push_back(move(group));
+				}
+				else
+				{
+					prepareGroup(group);
+					read.groups.push_back(move(group));
+				}
+			}
+			continue;
+		}
+
+		string name = xml.Name();
+		StreamContext parent = contexts.empty() ? STREAM_IGNORED : contexts.back();
+		StreamContext context = STREAM_IGNORED;
+
+		if (contexts.empty() && !rootSeen)
+		{
+			rootSeen = true;
+			context = STREAM_ROOT;
+		}
+		else if (parent == STREAM_ROOT)
+		{
+			if (name == "window" && !windowSeen)
+			{
+				windowSeen = true;
+				read.window = loadWindow(&xml);
+			}
+			else if (name == "camera" && !cameraSeen)
+			{
+				cameraSeen = true;
+				context = STREAM_CAMERA;
+			}
+			else if (name == "group")
+			{
+				open.emplace_back();
+				context = STREAM_GROUP;
+			}
+		}
+		else if (parent == STREAM_CAMERA)
+		{
+			if (name == "position" && !positionSeen)
+			{
+				positionSeen = true;
+				position = vectorAttribute(&xml, 0);
+			}
+			else if (name == "lookAt" && !lookAtSeen)
+			{
+				lookAtSeen = true;
+				lookAt = vectorAttribute(&xml, 0);
+			}
+			else if (name == "up" && !upSeen)
+			{
+				upSeen = true;
+				upVector = vectorAttribute(&xml, 0);
+			}
+			else if (name == "projection" && !projectionSeen)
+			{
+				projectionSeen = true;
+				projection = loadProjection(&xml);
+			}
+		}
+		else if (parent == STREAM_GROUP && name == "transform")
+		{
+			context = STREAM_TRANSFORMS;
+		}
+		else if ((parent == STREAM_GROUP && (name == "translate" || name == "rotate" || name == "scale")) || parent == STREAM_TRANSFORMS)
+		{
+			Transform transform;
+			if (readTransform(&xml, transform))
+			{
+				if (timedTranslate(transform))
+				{
+					path = transform;
+					points.clear();
+					context = STREAM_PATH;
+				}
+				else
+				{
+					open.back().transforms.push_back(transform);
+				}
+			}
+		}
+		else if (parent == STREAM_GROUP && name == "models")
+		{
+			context = STREAM_MODELS;
+		}
+		else if (parent == STREAM_GROUP && name == "group")
+		{
+			open.emplace_back();
+			context = STREAM_GROUP;
+		}
+		else if (parent == STREAM_MODELS && name == "model")
+		{
+			Model model;
+			if (loadModel(&xml, model))
+				open.back().models.push_back(model);
+		}
+		else if (parent == STREAM_PATH && name == "point")
+		{
+			points.push_back(loadPoint(&xml));
+		}
+		contexts.push_back(context);
+	}
+
+	memoryRemove(MEMORY_XML, xmlBytes);
+	if (event != XML_STREAM_DONE)
+		return false;
+
+	scene.window = read.window;
+	scene.camera = read.camera;
+	for (Group& g : read.groups)
+		scene.groups.push_back(move(g));
+	return true;
+}
+
+bool readScene(XMLDocument& xmlFile, World& scene)
+{
+	// Get root Element
+	XMLElement* pRootElement = xmlFile.RootElement();
+
+	// Enter rootElement which is World
+	if (pRootElement != NULL)
+	{
+		// Enter window element
+		XMLElement* pWindow = pRootElement->FirstChildElement("window");
+		if (pWindow != NULL)
+		{
+			// Create window in global variable world
+			scene.window = loadWindow(pWindow);
+		}
+
+		// Enter camera element
+		XMLElement* pCamera = pRootElement->FirstChildElement("camera");
+		if (pCamera != NULL)
+		{
+			vec3 position, lookAt, upVector;
+			Projection projection;
+
+			// Enter position element
+			XMLElement* pPosition = pCamera->FirstChildElement("position");
+			if (pPosition != NULL)
+			{
+				// Camera Position
+				position = vectorAttribute(pPosition, 0);
+			}
+
+			// Enter lookAt element
+			XMLElement* pLookAt = pCamera->FirstChildElement("lookAt");
+			if (pLookAt != NULL)
+			{
+				// Camera lookAt
+				lookAt = vectorAttribute(pLookAt, 0);
+			}
+
+			// Enter up element
+			XMLElement* pUpVector = pCamera->FirstChildElement("up");
+			if (pUpVector != NULL)
+			{
+				// Camera upVector
+				upVector = vectorAttribute(pUpVector, 0);
+			}
+
+			// Enter projection element
+			XMLElement* pProjection = pCamera->FirstChildElement("projection");
+			if (pProjection != NULL)
+			{
+				// Camera Projection
+				projection = loadProjection(pProjection);
+			}
+
+			// Create camera in global variable world
+			scene.camera = Camera(position, lookAt, upVector, projection);
+		}
+
+		// Run through every group element
+		XMLElement* pGroup = pRootElement->FirstChildElement("group");
+		while (pGroup)
+		{
+			Group group;
+			loadGroup(pGroup, group);
+
+			// Add group to group vector in world
+			prepareGroup(group);
+			scene.groups.push_back(group);
+
+			// Change pointer to next group element
+			pGroup = pGroup->NextSiblingElement("group");
+		}
+	}
+
+	return pRootElement != NULL;
+}
+
+bool loadScene(const char* fileName, World& scene)
+{
+	// The document is thrown away after reading, so its nodes come from an arena in a few large pieces
+	XMLArena arena;
+	XMLDocument xmlFile;
+	xmlFile.SetAllocator(&arena);
+	xmlFile.SetPoolBlockSize(SCENE_XML_BLOCK);
+	return loadScene(fileName, scene, xmlFile);
+}
+
+bool loadScene(const char* fileName, World& scene, XMLDocument& xmlFile)
+{
+	PROFILE_SCOPE("load xml");
+
+	// Large scenes are streamed, their document would take several times the file size
+	error_code error;
+	uintmax_t size = filesystem::file_size(fileName, error);
+	if (!error && size >= SCENE_STREAM_BYTES)
+		return streamScene(fileName, scene);
+
+	/*
+	* A retaining document reads the file into the buffer it kept from the
+	* last load; any other maps it, and its pages are copied as the parser
+	* writes to them, which ends up being nearly all of them.
+	*/
+	bool retain = xmlFile.RetainMemory();
+	size_t held = retain ? xmlFile.MemoryUsage() : 0;
+	XMLError loaded = retain ? xmlFile.LoadFile(fileName) : xmlFile.MapFile(fileName);
+
+	// The document counts towards the peak while the scene is read, and for as long as it is retained
+	size_t xmlBytes = xmlFile.MemoryUsage();
+	if (xmlBytes > held)
+		memoryAdd(MEMORY_XML, xmlBytes - held);
+
+	bool read = loaded == XML_SUCCESS && readScene(xmlFile, scene);
+
+	if (!retain)
+		memoryRemove(MEMORY_XML, xmlBytes);
+	xmlFile.Clear();
+	return read;
+}
+
+bool loadXML(char* fileName)
+{
+	bool loaded = loadScene(fileName, world);
+	if (!loaded)
+		cout << "Could not load scene " << fileName << "!" << endl;
+
+	for (const Group& g : world.groups)
+		animated = animated || g.animated;
+	memoryAdd(MEMORY_SCENE, sceneBytes(world));
+	return loaded;
+}
+
+bool loadMesh(const Model& model, ModelData& data)
+{
+	bool loaded = true;
+	if (!model.primitive.empty())
+		buildPrimitive(model.primitive, model.params, data.mesh);
+	else if (!mapModels || !data.mapped.open(model.file.c_str()))
+		loaded = readModel(model.file.c_str(), data.mesh);
+
+	// Reading the bounds pages the whole mapping in, it isn't needed again until drawn
+	Point min, max;
+	pointBounds(data.vertexData(), data.vertexCount(), min, max);
+	data.mapped.release();
+	data.bounds = AABB(vec3(min.x, min.y, min.z), vec3(max.x, max.y, max.z));
+	return loaded;
+}
+
+void loadModels(Group& group)
+{
+	/*
+	* Every distinct model is loaded or generated only once: models with the
+	* same file or the same primitive spec point to one shared mesh.
+	*/
+	for (Model& m : group.models)
+	{
+		string key = m.key();
+		map<string, ModelData>::iterator cached = modelCache.find(key);
+		if (cached != modelCache.end())
+		{
+			m.data = &cached->second;
+			continue;
+		}
+
+		ModelData& data = modelCache[key];
+		m.data = &data;
+
+		if (!loadMesh(m, data))
+			cout << "Could not load model " << m.file << "!" << endl;
+		memoryAdd(MEMORY_MESHES, meshBytes(data));
+	}
+
+	for (Group& child : group.groups)
+		loadModels(child);
+}
+
+void loadModels()
+{
+	PROFILE_SCOPE("load models");
+
+	for (Group& g : world.groups)
+		loadModels(g);
+}
+
+void clearScene()
+{
+	memoryRemove(MEMORY_SCENE, sceneBytes(world));
+	for (const pair<const string, ModelData>& entry : modelCache)
+		memoryRemove(MEMORY_MESHES, meshBytes(entry.second));
+
+	world = World();
+	modelCache.clear();
+	animated = false;
+}
@@ -0,0 +1,229 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <stddef.h>
+#include <vector>
+#include <string>
+#include <map>
+#include <list>
+#include <memory>
+#include "mesh.h"
+#include "vecmath.h"
+#include "curve.h"
+
+namespace tinyxml2
+{
+	class XMLDocument;
+}
+
+/*
+* Scene description and loading: the world read from the scene XML and
+* the meshes its models refer to. Nothing here touches OpenGL, so tools
+* and benchmarks can load scenes without a window; the engine owns the
+* buffer names stored in the scene.
+*/
+
+class Projection
+{
+public:
+	float fov;		// vertical field of view in degrees
+	float near;
+	float far;
+
+	// Defaults used when the scene has no <projection>
+	Projection() : fov(45.0f), near(1.0f), far(1000.0f) {};
+	Projection(float newFov, float newNear, float newFar)
+	{
+		fov = newFov;
+		near = newNear;
+		far = newFar;
+	}
+};
+
+class Window
+{
+public:
+	int width;
+	int height;
+
+	Window() {};
+	Window(int newWidth, int newHeight)
+	{
+		width = newWidth;
+		height = newHeight;
+	}
+};
+
+class Camera
+{
+public:
+	vec3 position;
+	vec3 lookAt;
+	vec3 upVector;
+	Projection projection;
+
+	Camera() {};
+	Camera(vec3 newPosition, vec3 newLookAt, vec3 newUpVector, Projection newProjection)
+	{
+		position = newPosition;
+		lookAt = newLookAt;
+		upVector = newUpVector;
+		projection = newProjection;
+	}
+};
+
+class ModelData
+{
+public:
+	Mesh mesh;
+	MappedModel mapped;			// the model file used in place instead of mesh, see mapModels
+	AABB bounds;				// object space bounds of the mesh
+	unsigned int buffer = 0;	// GL vertex buffer, created by uploadModels
+	size_t bufferSize = 0;		// bytes in the buffer
+	bool streaming = false;		// queued for a loader thread, mesh and bounds not there yet
+	unsigned int lastUsed = 0;	// last frame a visible model used it, for eviction
+	std::list<ModelData*>::iterator resident;	// place in the engine's LRU list while resident
+
+	const Point* vertexData() const
+	{
+		return mapped.vertices != NULL ? mapped.vertices : mesh.vertices.data();
+	}
+
+	size_t vertexCount() const
+	{
+		return mapped.vertices != NULL ? mapped.count : mesh.vertices.size();
+	}
+};
+
+class Model
+{
+public:
+	std::string file;				// model file, empty for procedural models
+	std::string primitive;			// primitive name for procedural models
+	std::vector<float> params;		// primitive parameters, in buildPrimitive order
+	ModelData* data = NULL;		// geometry, shared by every model with the same key
+
+	// Identifies the geometry: models with the same key share one entry in the model cache
+	std::string key() const;
+};
+
+class Path
+{
+public:
+	Curve curve;
+	mutable unsigned int buffer = 0;	// GL line loop through the arc length table, uploaded on first draw
+};
+
+class Transform
+{
+public:
+	enum Type { TRANSLATE, ROTATE, SCALE };
+
+	Type type;
+	vec3 vector;				// translation, rotation axis or scale factors
+	float angle = 0;			// rotation angle in degrees
+	float time = 0;				// seconds per lap of the path or full turn, 0 for static transforms
+	bool align = false;			// orient the group along the path
+	std::shared_ptr<Path> path;		// closed Catmull-Rom path of timed translations
+	mat4 pathMatrix;			// world matrix the path is drawn with, cached by updateGroup
+
+	// Matrix of the transform at the given animation time
+	mat4 matrix(double seconds) const;
+};
+
+class Group
+{
+public:
+	std::vector<Transform> transforms;	// applied in document order
+	std::vector<Model> models;
+	std::vector<Group> groups;			// nested groups, inherit this group's transforms
+
+	bool timed = false;				// some transform of this group changes with time
+	bool animated = false;			// this group or a nested one is timed
+	mat4 local;						// product of the transforms, for groups that are not timed
+	mat4 world;						// parent world * transforms, cached by updateGroup
+	AABB bounds;					// world space bounds of the group's own models
+	bool visible = true;			// bounds intersect the view frustum, cached by cullGroup
+};
+
+class World
+{
+public:
+	Window window;
+	Camera camera;
+	std::vector <Group> groups;
+};
+
+// Every distinct mesh, keyed by Model::key()
+extern std::map<std::string, ModelData> modelCache;
+extern World world;
+
+// True when some transform depends on time, so the animation clock must run
+extern bool animated;
+
+// Binary model files are mapped by loadMesh instead of read into memory
+extern bool mapModels;
+
+// Reads the scene XML into world, false if it can't be parsed
+bool loadXML(char* fileName);
+
+/*
+* Version of what the scene readers make of a file. Bump it whenever the
+* same XML would read differently (say, how bad or missing numbers are
+* taken), so that scene caches written by older readers stop matching.
+*/
+#define SCENE_READER_VERSION 2
+
+// Scene files from this size on are read by streamScene
+#define SCENE_STREAM_BYTES	(16 << 20)
+
+// Node pool blocks of the documents scenes are parsed into
+#define SCENE_XML_BLOCK		(64 * 1024)
+
+// Reads a scene XML into scene, false if the file can't be parsed; safe on any thread
+bool loadScene(const char* fileName, World& scene);
+
+/*
+* The same parsing into a document the caller keeps, which is cleared
+* afterwards: one with SetRetainMemory reuses its buffers from one load
+* to the next. A document must not be shared between threads.
+*/
+bool loadScene(const char* fileName, World& scene, tinyxml2::XMLDocument& xmlFile);
+
+// Reads a scene XML as a stream, without ever holding a document of the whole file
+bool streamScene(const char* fileName, World& scene);
+
+// Loads or generates the mesh of every model in world, once per distinct key
+void loadModels();
+
+// Reads or generates the mesh of one model and its bounds; safe on any thread
+bool loadMesh(const Model& model, ModelData& data);
+
+// Empties world and the model cache; GL buffers must be released by the caller first
+void clearScene();
+
+// Multiplies the static transforms of a group tree and flags what is animated
+void prepareGroup(Group& group);
+
+// Memory held by a mesh in main memory and in its vertex buffer
+size_t meshBytes(const ModelData& data);
+size_t bufferBytes(const ModelData& data);
+
+class GroupMemory
+{
+public:
+	int groups = 0;								// groups in the subtree
+	size_t scene = 0;							// scene graph bytes of the subtree
+	std::map<const ModelData*, int> references;	// models of the subtree using each mesh
+
+	// Bytes of the distinct meshes referenced, in memory and in vertex buffers
+	void meshBytes(size_t& cpu, size_t& gpu) const;
+};
+
+// Adds the memory of a group and everything nested in it
+void groupMemory(const Group& group, GroupMemory& memory);
+
+// Memory of a whole scene graph, meshes excluded
+size_t sceneBytes(const World& scene);
+
+#endif
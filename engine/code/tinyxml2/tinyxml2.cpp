@@ -32,6 +32,23 @@ distribution.
 #   include <cstdarg>
 #endif
 
+#if __cplusplus >= 201703L && defined(__has_include)
+#   if __has_include(<charconv>)
+#       include <charconv>
+#   endif
+#endif
+#ifdef __cpp_lib_to_chars
+#   define TIXML_FROM_CHARS
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#   define TIXML_MAP_FILES
+#endif
+
 #if defined(_MSC_VER) && (_MSC_VER >= 1400 ) && (!defined WINCE)
 	// Microsoft Visual Studio, version 2005 and higher. Not WinCE.
 	/*int _snprintf_s(
@@ -171,22 +188,37 @@ void StrPair::Reset()
     if ( _flags & NEEDS_DELETE ) {
         delete [] _start;
     }
+    else if ( _flags & NEEDS_FREE ) {
+        AllocatedStr* allocated = reinterpret_cast<AllocatedStr*>( _start ) - 1;
+        allocated->allocator->Free( allocated, allocated->size );
+    }
     _flags = 0;
     _start = 0;
     _end = 0;
 }
 
 
-void StrPair::SetStr( const char* str, int flags )
+void StrPair::SetStr( const char* str, int flags, XMLAllocator* allocator )
 {
     TIXMLASSERT( str );
     Reset();
     size_t len = strlen( str );
     TIXMLASSERT( _start == 0 );
-    _start = new char[ len+1 ];
+    if ( allocator ) {
+        // The allocator and size are kept in front of the text for Reset()
+        const size_t size = sizeof( AllocatedStr ) + len + 1;
+        AllocatedStr* allocated = static_cast<AllocatedStr*>( allocator->Allocate( size ) );
+        allocated->allocator = allocator;
+        allocated->size = size;
+        _start = reinterpret_cast<char*>( allocated + 1 );
+        _flags = flags | NEEDS_FREE;
+    }
+    else {
+        _start = new char[ len+1 ];
+        _flags = flags | NEEDS_DELETE;
+    }
     memcpy( _start, str, len+1 );
     _end = _start + len;
-    _flags = flags | NEEDS_DELETE;
 }
 
 
@@ -238,7 +270,7 @@ char* StrPair::ParseName( char* p )
 void StrPair::CollapseWhitespace()
 {
     // Adjusting _start would cause undefined behavior on delete[]
-    TIXMLASSERT( ( _flags & NEEDS_DELETE ) == 0 );
+    TIXMLASSERT( ( _flags & ( NEEDS_DELETE | NEEDS_FREE ) ) == 0 );
     // Trim leading space.
     _start = XMLUtil::SkipWhiteSpace( _start, 0 );
 
@@ -358,7 +390,7 @@ const char* StrPair::GetStr()
         if ( _flags & NEEDS_WHITESPACE_COLLAPSING ) {
             CollapseWhitespace();
         }
-        _flags = (_flags & NEEDS_DELETE);
+        _flags = (_flags & ( NEEDS_DELETE | NEEDS_FREE ));
     }
     TIXMLASSERT( _start );
     return _start;
@@ -367,6 +399,58 @@ const char* StrPair::GetStr()
 
 
 
+// --------- XMLArena ----------- //
+
+XMLArena::XMLArena( size_t chunkSize ) :
+    _chunks(),
+    _chunkSize( chunkSize ),
+    _next( 0 ),
+    _left( 0 ),
+    _capacity( 0 )
+{
+}
+
+
+XMLArena::~XMLArena()
+{
+    Release();
+}
+
+
+void* XMLArena::Allocate( size_t size )
+{
+    // Every allocation starts aligned like malloc's
+    const size_t ALIGN = sizeof( void* ) * 2;
+    size = ( size + ALIGN - 1 ) / ALIGN * ALIGN;
+
+    if ( size > _left ) {
+        // A new chunk; allocations larger than a chunk get one of their own
+        Chunk chunk;
+        chunk.size = size > _chunkSize ? size : _chunkSize;
+        chunk.mem = new char[chunk.size];
+        _chunks.Push( chunk );
+        _capacity += chunk.size;
+        _next = chunk.mem;
+        _left = chunk.size;
+    }
+    void* mem = _next;
+    _next += size;
+    _left -= size;
+    return mem;
+}
+
+
+void XMLArena::Release()
+{
+    while ( !_chunks.Empty() ) {
+        delete [] _chunks.Pop().mem;
+    }
+    _next = 0;
+    _left = 0;
+    _capacity = 0;
+}
+
+
 // --------- XMLUtil ----------- //
 
 const char* XMLUtil::writeBoolTrue  = "true";
@@ -589,8 +673,39 @@ void XMLUtil::ToStr(int64_t v, char* buffer, int bufferSize)
 }
 
 
+#ifdef TIXML_FROM_CHARS
+// The fast path for plain numbers: std::from_chars needs no locale and no
+// format string. What it doesn't take the way scanf does (a leading '+',
+// hexadecimal floats, values out of range) is left to TIXML_SSCANF.
+template<typename T>
+static bool FromChars( const char* str, T* value )
+{
+    while ( XMLUtil::IsWhiteSpace( *str ) ) {
+        ++str;
+    }
+    const char* end = str + strlen( str );
+    T v;
+    const std::from_chars_result result = std::from_chars( str, end, v );
+    if ( result.ec != std::errc() || *result.ptr == 'x' || *result.ptr == 'X' ) {
+        return false;
+    }
+    *value = v;
+    return true;
+}
+#else
+template<typename T>
+static bool FromChars( const char*, T* )
+{
+    return false;
+}
+#endif
+
+
 bool XMLUtil::ToInt( const char* str, int* value )
 {
+    if ( FromChars( str, value ) ) {
+        return true;
+    }
     if ( TIXML_SSCANF( str, "%d", value ) == 1 ) {
         return true;
     }
@@ -599,6 +714,9 @@ bool XMLUtil::ToInt( const char* str, int* value )
 
 bool XMLUtil::ToUnsigned( const char* str, unsigned *value )
 {
+    if ( FromChars( str, value ) ) {
+        return true;
+    }
     if ( TIXML_SSCANF( str, "%u", value ) == 1 ) {
         return true;
     }
@@ -626,6 +744,9 @@ bool XMLUtil::ToBool( const char* str, bool* value )
 
 bool XMLUtil::ToFloat( const char* str, float* value )
 {
+    if ( FromChars( str, value ) ) {
+        return true;
+    }
     if ( TIXML_SSCANF( str, "%f", value ) == 1 ) {
         return true;
     }
@@ -635,6 +756,9 @@ bool XMLUtil::ToFloat( const char* str, float* value )
 
 bool XMLUtil::ToDouble( const char* str, double* value )
 {
+    if ( FromChars( str, value ) ) {
+        return true;
+    }
     if ( TIXML_SSCANF( str, "%lf", value ) == 1 ) {
         return true;
     }
@@ -644,6 +768,9 @@ bool XMLUtil::ToDouble( const char* str, double* value )
 
 bool XMLUtil::ToInt64(const char* str, int64_t* value)
 {
+	if (FromChars(str, value)) {
+		return true;
+	}
 	long long v = 0;	// horrible syntax trick to make the compiler happy about %lld
 	if (TIXML_SSCANF(str, "%lld", &v) == 1) {
 		*value = (int64_t)v;
@@ -774,7 +901,7 @@ void XMLNode::SetValue( const char* str, bool staticMem )
         _value.SetInternedStr( str );
     }
     else {
-        _value.SetStr( str );
+        _value.SetStr( str, 0, _memPool ? _memPool->Allocator() : 0 );
     }
 }
 
@@ -1369,7 +1496,7 @@ char* XMLAttribute::ParseDeep( char* p, bool processEntities, int* curLineNumPtr
 
 void XMLAttribute::SetName( const char* n )
 {
-    _name.SetStr( n );
+    _name.SetStr( n, 0, _memPool->Allocator() );
 }
 
 
@@ -1429,7 +1556,7 @@ XMLError XMLAttribute::QueryDoubleValue( double* value ) const
 
 void XMLAttribute::SetAttribute( const char* v )
 {
-    _value.SetStr( v );
+    _value.SetStr( v, 0, _memPool->Allocator() );
 }
 
 
@@ -1437,7 +1564,7 @@ void XMLAttribute::SetAttribute( int v )
 {
     char buf[BUF_SIZE];
     XMLUtil::ToStr( v, buf, BUF_SIZE );
-    _value.SetStr( buf );
+    _value.SetStr( buf, 0, _memPool->Allocator() );
 }
 
 
@@ -1445,7 +1572,7 @@ void XMLAttribute::SetAttribute( unsigned v )
 {
     char buf[BUF_SIZE];
     XMLUtil::ToStr( v, buf, BUF_SIZE );
-    _value.SetStr( buf );
+    _value.SetStr( buf, 0, _memPool->Allocator() );
 }
 
 
@@ -1453,7 +1580,7 @@ void XMLAttribute::SetAttribute(int64_t v)
 {
 	char buf[BUF_SIZE];
 	XMLUtil::ToStr(v, buf, BUF_SIZE);
-	_value.SetStr(buf);
+	_value.SetStr(buf, 0, _memPool->Allocator());
 }
 
 
@@ -1462,28 +1589,63 @@ void XMLAttribute::SetAttribute( bool v )
 {
     char buf[BUF_SIZE];
     XMLUtil::ToStr( v, buf, BUF_SIZE );
-    _value.SetStr( buf );
+    _value.SetStr( buf, 0, _memPool->Allocator() );
 }
 
 void XMLAttribute::SetAttribute( double v )
 {
     char buf[BUF_SIZE];
     XMLUtil::ToStr( v, buf, BUF_SIZE );
-    _value.SetStr( buf );
+    _value.SetStr( buf, 0, _memPool->Allocator() );
 }
 
 void XMLAttribute::SetAttribute( float v )
 {
     char buf[BUF_SIZE];
     XMLUtil::ToStr( v, buf, BUF_SIZE );
-    _value.SetStr( buf );
+    _value.SetStr( buf, 0, _memPool->Allocator() );
 }
 
 
 // --------- XMLElement ---------- //
+
+/*
+	Open addressing table over the attributes of a wide element, kept at
+	most half full. The slots follow it in the same allocation. It
+	is also linked into the document's list of indexes.
+*/
+struct XMLElement::AttributeIndex
+{
+    XMLDocument*    document;
+    AttributeIndex* prev;
+    AttributeIndex* next;
+    XMLAllocator*   allocator;
+    size_t          size;
+    int             capacity;       // a power of two
+    int             count;
+    XMLAttribute*   last;           // tail of the list, attributes are indexed in list order
+
+    XMLAttribute** Slots() {
+        return reinterpret_cast<XMLAttribute**>( this + 1 );
+    }
+};
+
+
+static unsigned HashAttributeName( const char* name )
+{
+    // FNV-1a
+    unsigned hash = 2166136261u;
+    for( ; *name; ++name ) {
+        hash = ( hash ^ static_cast<unsigned char>( *name ) ) * 16777619u;
+    }
+    return hash;
+}
+
+
 XMLElement::XMLElement( XMLDocument* doc ) : XMLNode( doc ),
     _closingType( OPEN ),
-    _rootAttribute( 0 )
+    _rootAttribute( 0 ),
+    _attributeIndex( 0 )
 {
 }
 
@@ -1495,11 +1657,23 @@ XMLElement::~XMLElement()
         DeleteAttribute( _rootAttribute );
         _rootAttribute = next;
     }
+    FreeAttributeIndex();
 }
 
 
 const XMLAttribute* XMLElement::FindAttribute( const char* name ) const
 {
+    if ( _attributeIndex ) {
+        const unsigned hash = HashAttributeName( name );
+        XMLAttribute** slots = _attributeIndex->Slots();
+        const int mask = _attributeIndex->capacity - 1;
+        for( int i = hash & mask; slots[i]; i = ( i + 1 ) & mask ) {
+            if ( slots[i]->_nameHash == hash && XMLUtil::StringEqual( slots[i]->Name(), name ) ) {
+                return slots[i];
+            }
+        }
+        return 0;
+    }
     for( XMLAttribute* a = _rootAttribute; a; a = a->_next ) {
         if ( XMLUtil::StringEqual( a->Name(), name ) ) {
             return a;
@@ -1563,6 +1737,41 @@ float XMLElement::FloatAttribute(const char* name, float defaultValue) const
 	return f;
 }
 
+XMLError XMLElement::QueryFloatTriple( const char* name0, const char* name1, const char* name2, float* values ) const
+{
+    TIXMLASSERT( values );
+    const char* names[3] = { name0, name1, name2 };
+    int found = 0;
+    bool converted = true;
+    if ( _attributeIndex ) {
+        // Three hashed lookups beat a pass over a long list
+        for( int i = 0; i < 3; ++i ) {
+            const XMLAttribute* a = names[i] ? FindAttribute( names[i] ) : 0;
+            if ( a ) {
+                converted = XMLUtil::ToFloat( a->Value(), &values[i] ) && converted;
+                ++found;
+            }
+        }
+    }
+    else {
+        for( const XMLAttribute* a = _rootAttribute; a && found < 3; a = a->_next ) {
+            const char* name = a->Name();
+            for( int i = 0; i < 3; ++i ) {
+                if ( names[i] && XMLUtil::StringEqual( name, names[i] ) ) {
+                    converted = XMLUtil::ToFloat( a->Value(), &values[i] ) && converted;
+                    names[i] = 0;
+                    ++found;
+                    break;
+                }
+            }
+        }
+    }
+    if ( !converted ) {
+        return XML_WRONG_ATTRIBUTE_TYPE;
+    }
+    return found == 3 ? XML_SUCCESS : XML_NO_ATTRIBUTE;
+}
+
 const char* XMLElement::GetText() const
 {
     if ( FirstChild() && FirstChild()->ToText() ) {
@@ -1754,26 +1963,38 @@ float XMLElement::FloatText(float defaultValue) const
 XMLAttribute* XMLElement::FindOrCreateAttribute( const char* name )
 {
     XMLAttribute* last = 0;
-    XMLAttribute* attrib = 0;
-    for( attrib = _rootAttribute;
-            attrib;
-            last = attrib, attrib = attrib->_next ) {
-        if ( XMLUtil::StringEqual( attrib->Name(), name ) ) {
-            break;
+    int count = 0;
+    if ( _attributeIndex ) {
+        XMLAttribute* found = FindAttribute( name );
+        if ( found ) {
+            return found;
         }
+        // The index knows the tail, so wide elements are never walked
+        last = _attributeIndex->last;
+        count = _attributeIndex->count;
     }
-    if ( !attrib ) {
-        attrib = CreateAttribute();
-        TIXMLASSERT( attrib );
-        if ( last ) {
-            TIXMLASSERT( last->_next == 0 );
-            last->_next = attrib;
-        }
-        else {
-            TIXMLASSERT( _rootAttribute == 0 );
-            _rootAttribute = attrib;
+    else {
+        for( XMLAttribute* a = _rootAttribute; a; a = a->_next ) {
+            if ( XMLUtil::StringEqual( a->Name(), name ) ) {
+                return a;
+            }
+            last = a;
+            ++count;
         }
-        attrib->SetName( name );
+    }
+    XMLAttribute* attrib = CreateAttribute();
+    TIXMLASSERT( attrib );
+    if ( last ) {
+        TIXMLASSERT( last->_next == 0 );
+        last->_next = attrib;
+    }
+    else {
+        TIXMLASSERT( _rootAttribute == 0 );
+        _rootAttribute = attrib;
+    }
+    attrib->SetName( name );
+    if ( _attributeIndex || count + 1 >= TINYXML2_ATTRIBUTE_INDEX_THRESHOLD ) {
+        IndexAttribute( attrib );
     }
     return attrib;
 }
@@ -1790,6 +2011,9 @@ void XMLElement::DeleteAttribute( const char* name )
             else {
                 _rootAttribute = a->_next;
             }
+            if ( _attributeIndex ) {
+                BuildAttributeIndex();
+            }
             DeleteAttribute( a );
             break;
         }
@@ -1801,6 +2025,7 @@ void XMLElement::DeleteAttribute( const char* name )
 char* XMLElement::ParseAttributes( char* p, int* curLineNumPtr )
 {
     XMLAttribute* prevAttribute = 0;
+    int count = 0;
 
     // Read the attributes.
     while( p ) {
@@ -1838,6 +2063,11 @@ char* XMLElement::ParseAttributes( char* p, int* curLineNumPtr )
                 _rootAttribute = attrib;
             }
             prevAttribute = attrib;
+            // Indexed as soon as the element gets wide, so that the
+            // duplicate check above stays cheap for the rest
+            if ( _attributeIndex || ++count >= TINYXML2_ATTRIBUTE_INDEX_THRESHOLD ) {
+                IndexAttribute( attrib );
+            }
         }
         // end of the tag
         else if ( *p == '>' ) {
@@ -1867,6 +2097,98 @@ void XMLElement::DeleteAttribute( XMLAttribute* attribute )
     pool->Free( attribute );
 }
 
+void XMLElement::IndexAttribute( XMLAttribute* attrib )
+{
+    // attrib is already in the list; a rebuild picks it up from there
+    AttributeIndex* index = _attributeIndex;
+    if ( !index || ( index->count + 1 ) * 2 > index->capacity ) {
+        BuildAttributeIndex();
+        return;
+    }
+    attrib->_nameHash = HashAttributeName( attrib->Name() );
+    XMLAttribute** slots = index->Slots();
+    const int mask = index->capacity - 1;
+    int i = attrib->_nameHash & mask;
+    while( slots[i] ) {
+        i = ( i + 1 ) & mask;
+    }
+    slots[i] = attrib;
+    ++index->count;
+    index->last = attrib;
+}
+
+
+void XMLElement::BuildAttributeIndex()
+{
+    FreeAttributeIndex();
+    int count = 0;
+    for( const XMLAttribute* a = _rootAttribute; a; a = a->_next ) {
+        ++count;
+    }
+    if ( count < TINYXML2_ATTRIBUTE_INDEX_THRESHOLD ) {
+        return;
+    }
+    int capacity = 16;
+    while( capacity < count * 2 ) {
+        capacity *= 2;
+    }
+
+    const size_t size = sizeof( AttributeIndex ) + capacity * sizeof( XMLAttribute* );
+    XMLAllocator* allocator = _memPool ? _memPool->Allocator() : 0;
+    void* mem = allocator ? allocator->Allocate( size ) : new char[ size ];
+    AttributeIndex* index = static_cast<AttributeIndex*>( mem );
+    index->document = _document;
+    index->prev = 0;
+    index->next = _document->_attributeIndexes;
+    if ( index->next ) {
+        index->next->prev = index;
+    }
+    _document->_attributeIndexes = index;
+    index->allocator = allocator;
+    index->size = size;
+    index->capacity = capacity;
+    index->count = 0;
+    index->last = 0;
+    memset( index->Slots(), 0, capacity * sizeof( XMLAttribute* ) );
+    _attributeIndex = index;
+
+    for( XMLAttribute* a = _rootAttribute; a; a = a->_next ) {
+        IndexAttribute( a );
+    }
+}
+
+
+void XMLElement::FreeAttributeIndex()
+{
+    AttributeIndex* index = _attributeIndex;
+    if ( !index ) {
+        return;
+    }
+    _attributeIndex = 0;
+    FreeAttributeIndex( index );
+}
+
+
+void XMLElement::FreeAttributeIndex( AttributeIndex* index )
+{
+    if ( index->prev ) {
+        index->prev->next = index->next;
+    }
+    else {
+        index->document->_attributeIndexes = index->next;
+    }
+    if ( index->next ) {
+        index->next->prev = index->prev;
+    }
+    if ( index->allocator ) {
+        index->allocator->Free( index, index->size );
+    }
+    else {
+        delete [] reinterpret_cast<char*>( index );
+    }
+}
+
+
 XMLAttribute* XMLElement::CreateAttribute()
 {
     TIXMLASSERT( sizeof( XMLAttribute ) == _document->_attributePool.ItemSize() );
@@ -1999,12 +2321,16 @@ XMLDocument::XMLDocument( bool processEntities, Whitespace whitespaceMode ) :
     _errorStr(),
     _errorLineNum( 0 ),
     _charBuffer( 0 ),
+    _charBufferSize( 0 ),
+    _charBufferMapped( false ),
+    _retainMemory( false ),
     _parseCurLineNum( 0 ),
     _unlinked(),
     _elementPool(),
     _attributePool(),
     _textPool(),
-    _commentPool()
+    _commentPool(),
+    _attributeIndexes( 0 )
 {
     // avoid VC++ C4355 warning about 'this' in initializer list (C4355 is off by default in VS2012+)
     _document = this;
@@ -2014,6 +2340,7 @@ XMLDocument::XMLDocument( bool processEntities, Whitespace whitespaceMode ) :
 XMLDocument::~XMLDocument()
 {
     Clear();
+    FreeCharBuffer();
 }
 
 
@@ -2030,6 +2357,17 @@ void XMLDocument::MarkInUse(XMLNode* node)
 	}
 }
 
+void XMLDocument::FreeAttributeIndexes()
+{
+    // Whatever is left belongs to elements a failed parse leaked into the
+    // pools: their destructors never run, and resetting or clearing the
+    // pools would lose the indexes.
+    while( _attributeIndexes ) {
+        XMLElement::FreeAttributeIndex( _attributeIndexes );
+    }
+}
+
+
 void XMLDocument::Clear()
 {
     DeleteChildren();
@@ -2037,13 +2375,23 @@ void XMLDocument::Clear()
 		DeleteNode(_unlinked[0]);	// Will remove from _unlinked as part of delete.
 	}
 
+    FreeAttributeIndexes();
+
 #ifdef TINYXML2_DEBUG
     const bool hadError = Error();
 #endif
     ClearError();
 
-    delete [] _charBuffer;
-    _charBuffer = 0;
+    if ( _retainMemory ) {
+        // Nothing is in use any more, items leaked by a failed parse included
+        _elementPool.Reset();
+        _attributePool.Reset();
+        _textPool.Reset();
+        _commentPool.Reset();
+    }
+    if ( !_retainMemory || _charBufferMapped ) {
+        FreeCharBuffer();
+    }
 
 #if 0
     _textPool.Trace( "text" );
@@ -2063,6 +2411,95 @@ void XMLDocument::Clear()
 }
 
 
+char* XMLDocument::AllocCharBuffer( size_t size )
+{
+    // A retained buffer is reused when it is large enough
+    if ( _charBufferMapped || _charBufferSize < size ) {
+        FreeCharBuffer();
+        _charBuffer = new char[size];
+        _charBufferSize = size;
+    }
+    return _charBuffer;
+}
+
+
+void XMLDocument::FreeCharBuffer()
+{
+#ifdef TIXML_MAP_FILES
+    if ( _charBufferMapped ) {
+        munmap( _charBuffer, _charBufferSize );
+    }
+    else
+#endif
+    {
+        delete [] _charBuffer;
+    }
+    _charBuffer = 0;
+    _charBufferSize = 0;
+    _charBufferMapped = false;
+}
+
+
+void XMLDocument::SetRetainMemory( bool retain )
+{
+    _retainMemory = retain;
+    if ( !retain && NoChildren() && _unlinked.Empty() ) {
+        // Gives back what an empty document still holds
+        FreeCharBuffer();
+        _elementPool.Clear();
+        _attributePool.Clear();
+        _textPool.Clear();
+        _commentPool.Clear();
+    }
+}
+
+
+void XMLDocument::SetPoolBlockSize( size_t bytes )
+{
+    _elementPool.SetBlockSize( bytes );
+    _attributePool.SetBlockSize( bytes );
+    _textPool.SetBlockSize( bytes );
+    _commentPool.SetBlockSize( bytes );
+}
+
+
+void XMLDocument::SetAllocator( XMLAllocator* allocator )
+{
+    _elementPool.SetAllocator( allocator );
+    _attributePool.SetAllocator( allocator );
+    _textPool.SetAllocator( allocator );
+    _commentPool.SetAllocator( allocator );
+}
+
+
+void XMLDocument::PoolStats( Pool pool, XMLPoolStats* stats ) const
+{
+    TIXMLASSERT( stats );
+    switch ( pool ) {
+        case ELEMENT_POOL:
+            _elementPool.Stats( stats );
+            break;
+        case ATTRIBUTE_POOL:
+            _attributePool.Stats( stats );
+            break;
+        case TEXT_POOL:
+            _textPool.Stats( stats );
+            break;
+        default:
+            _commentPool.Stats( stats );
+            break;
+    }
+}
+
+
+size_t XMLDocument::MemoryUsage() const
+{
+    return _elementPool.Capacity() + _attributePool.Capacity()
+         + _textPool.Capacity() + _commentPool.Capacity()
+         + _charBufferSize;
+}
+
+
 void XMLDocument::DeepCopy(XMLDocument* target) const
 {
 	TIXMLASSERT(target);
@@ -2222,8 +2659,7 @@ XMLError XMLDocument::LoadFile( FILE* fp )
     }
 
     const size_t size = filelength;
-    TIXMLASSERT( _charBuffer == 0 );
-    _charBuffer = new char[size+1];
+    AllocCharBuffer( size+1 );
     size_t read = fread( _charBuffer, 1, size, fp );
     if ( read != size ) {
         SetError( XML_ERROR_FILE_READ_ERROR, 0, 0 );
@@ -2237,6 +2673,73 @@ XMLError XMLDocument::LoadFile( FILE* fp )
 }
 
 
+XMLError XMLDocument::MapFile( const char* filename )
+{
+#ifdef TIXML_MAP_FILES
+    if ( !filename ) {
+        TIXMLASSERT( false );
+        SetError( XML_ERROR_FILE_COULD_NOT_BE_OPENED, 0, "filename=<null>" );
+        return _errorID;
+    }
+
+    Clear();
+    const int fd = ::open( filename, O_RDONLY );
+    if ( fd < 0 ) {
+        SetError( XML_ERROR_FILE_NOT_FOUND, 0, "filename=%s", filename );
+        return _errorID;
+    }
+
+    struct stat info;
+    if ( fstat( fd, &info ) != 0 || info.st_size < 0 ) {
+        ::close( fd );
+        SetError( XML_ERROR_FILE_READ_ERROR, 0, 0 );
+        return _errorID;
+    }
+    if ( info.st_size == 0 ) {
+        ::close( fd );
+        SetError( XML_ERROR_EMPTY_DOCUMENT, 0, 0 );
+        return _errorID;
+    }
+
+    // The parser needs a null after the text. Zeroed anonymous pages one byte
+    // longer than the file are reserved and the file is mapped over their start:
+    // the rest of its last page and any page after it read as zero.
+    const size_t size = (size_t)info.st_size;
+    const size_t page = (size_t)sysconf( _SC_PAGESIZE );
+    const size_t mapped = ( size + page ) / page * page;
+    void* region = mmap( 0, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    if ( region == MAP_FAILED ) {
+        ::close( fd );
+        SetError( XML_ERROR_FILE_READ_ERROR, 0, 0 );
+        return _errorID;
+    }
+    if ( mmap( region, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0 ) == MAP_FAILED ) {
+        munmap( region, mapped );
+        ::close( fd );
+        SetError( XML_ERROR_FILE_READ_ERROR, 0, 0 );
+        return _errorID;
+    }
+    ::close( fd );
+    // Read ahead, but without populating: that would write-fault, and so
+    // copy, every page of the private mapping. Only the pages the parser
+    // writes to get copied.
+    madvise( region, size, MADV_SEQUENTIAL );
+    madvise( region, size, MADV_WILLNEED );
+
+    FreeCharBuffer();	// a buffer kept by SetRetainMemory()
+    _charBuffer = static_cast<char*>( region );
+    _charBufferSize = mapped;
+    _charBufferMapped = true;
+    TIXMLASSERT( _charBuffer[size] == 0 );
+
+    Parse();
+    return _errorID;
+#else
+    return LoadFile( filename );
+#endif
+}
+
+
 XMLError XMLDocument::SaveFile( const char* filename, bool compact )
 {
     if ( !filename ) {
@@ -2278,21 +2781,31 @@ XMLError XMLDocument::Parse( const char* p, size_t len )
     if ( len == (size_t)(-1) ) {
         len = strlen( p );
     }
-    TIXMLASSERT( _charBuffer == 0 );
-    _charBuffer = new char[ len+1 ];
+    AllocCharBuffer( len+1 );
     memcpy( _charBuffer, p, len );
     _charBuffer[len] = 0;
 
     Parse();
-    if ( Error() ) {
+    if ( Error() && !_retainMemory ) {
         // clean up now essentially dangling memory.
         // and the parse fail can put objects in the
         // pools that are dead and inaccessible.
+        // (Retaining documents reset their pools on Clear() instead.)
         DeleteChildren();
-        _elementPool.Clear();
-        _attributePool.Clear();
-        _textPool.Clear();
-        _commentPool.Clear();
+        FreeAttributeIndexes();
+        if ( Allocator() ) {
+            // Blocks given back to an arena are gone for good; keep them for the next parse
+            _elementPool.Reset();
+            _attributePool.Reset();
+            _textPool.Reset();
+            _commentPool.Reset();
+        }
+        else {
+            _elementPool.Clear();
+            _attributePool.Clear();
+            _textPool.Clear();
+            _commentPool.Clear();
+        }
     }
     return _errorID;
 }
@@ -2332,7 +2845,8 @@ void XMLDocument::SetError( XMLError error, int lineNum, const char* format, ...
 		TIXML_VSNPRINTF(buffer + len, BUFFER_SIZE - len, format, va);
 		va_end(va);
 	}
-	_errorStr.SetStr(buffer);
+	// Not from the document's allocator: an arena would keep every error
+	_errorStr.SetStr(buffer, 0);
 	delete[] buffer;
 }
 
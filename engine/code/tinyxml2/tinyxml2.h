@@ -106,6 +106,14 @@ static const int TIXML2_PATCH_VERSION = 0;
 #define TINYXML2_MINOR_VERSION 1
 #define TINYXML2_PATCH_VERSION 0
 
+/*
+	Elements with at least this many attributes look them up through a
+	hash table instead of scanning the attribute list.
+*/
+#ifndef TINYXML2_ATTRIBUTE_INDEX_THRESHOLD
+#define TINYXML2_ATTRIBUTE_INDEX_THRESHOLD 8
+#endif
+
 namespace tinyxml2
 {
 class XMLDocument;
@@ -117,6 +125,21 @@ class XMLDeclaration;
 class XMLUnknown;
 class XMLPrinter;
 
+/**
+	Source of the memory a document allocates its node pool blocks and
+	the strings set through the API from, see XMLDocument::SetAllocator().
+	Free() is given the size that was asked for. Allocations must be
+	aligned for any type.
+*/
+class TINYXML2_LIB XMLAllocator
+{
+public:
+    virtual ~XMLAllocator() {}
+
+    virtual void* Allocate( size_t size ) = 0;
+    virtual void Free( void* mem, size_t size ) = 0;
+};
+
 /*
 	A class that wraps strings. Normally stores the start and end
 	pointers into the XML file itself, and will apply normalization
@@ -162,7 +185,8 @@ public:
         _start = const_cast<char*>(str);
     }
 
-    void SetStr( const char* str, int flags=0 );
+    // Copies str, from allocator when one is given
+    void SetStr( const char* str, int flags=0, XMLAllocator* allocator=0 );
 
     char* ParseText( char* in, const char* endTag, int strFlags, int* curLineNumPtr );
     char* ParseName( char* in );
@@ -175,7 +199,13 @@ private:
 
     enum {
         NEEDS_FLUSH = 0x100,
-        NEEDS_DELETE = 0x200
+        NEEDS_DELETE = 0x200,
+        NEEDS_FREE = 0x400		// allocated from an XMLAllocator, recorded in an AllocatedStr before _start
+    };
+
+    struct AllocatedStr {
+        XMLAllocator*	allocator;
+        size_t			size;
     };
 
     int     _flags;
@@ -313,6 +343,47 @@ private:
 };
 
 
+/**
+	An XMLAllocator that carves allocations out of large chunks, for
+	documents that are loaded, read and thrown away: the node pools of
+	a large document then take a few big allocations instead of one
+	per block, laid out one after the other. Free() gives nothing back;
+	the chunks are released all at once by Release() or the destructor,
+	so the arena must outlive the documents using it. Not thread safe.
+*/
+class TINYXML2_LIB XMLArena : public XMLAllocator
+{
+public:
+    XMLArena( size_t chunkSize = 1024*1024 );
+    virtual ~XMLArena();
+
+    virtual void* Allocate( size_t size );
+    virtual void Free( void*, size_t ) {}
+
+    /// Frees every chunk; nothing allocated from the arena may be in use.
+    void Release();
+
+    /// Bytes held in chunks.
+    size_t Capacity() const {
+        return _capacity;
+    }
+
+private:
+    XMLArena( const XMLArena& );	// not supported
+    void operator=( const XMLArena& );	// not supported
+
+    struct Chunk {
+        char*	mem;
+        size_t	size;
+    };
+    DynArray< Chunk, 10 > _chunks;
+    size_t _chunkSize;
+    char* _next;		// free space left in the last chunk
+    size_t _left;
+    size_t _capacity;
+};
+
+
 /*
 	Parent virtual class of a pool for fast allocation
 	and deallocation of objects.
@@ -320,7 +391,7 @@ private:
 class MemPool
 {
 public:
-    MemPool() {}
+    MemPool() : _allocator( 0 ) {}
     virtual ~MemPool() {}
 
     virtual int ItemSize() const = 0;
@@ -328,6 +399,33 @@ public:
     virtual void Free( void* ) = 0;
     virtual void SetTracked() = 0;
     virtual void Clear() = 0;
+
+    /// Where new blocks come from, and the strings of the nodes in the pool; 0 for new[].
+    XMLAllocator* Allocator() const {
+        return _allocator;
+    }
+    void SetAllocator( XMLAllocator* allocator ) {
+        _allocator = allocator;
+    }
+
+protected:
+    XMLAllocator* _allocator;
+};
+
+
+/**
+	Usage of one of the node pools of a document,
+	see XMLDocument::PoolStats().
+*/
+struct XMLPoolStats
+{
+    int itemSize;		///< bytes per item
+    int currentAllocs;	///< items in use
+    int untracked;		///< items handed out and not yet linked into the document
+    int totalAllocs;	///< items handed out since the pool was emptied
+    int maxAllocs;		///< most items in use at once
+    int blocks;			///< blocks held, whether or not their items are in use
+    size_t capacity;	///< bytes held in blocks
 };
 
 
@@ -338,17 +436,24 @@ template< int ITEM_SIZE >
 class MemPoolT : public MemPool
 {
 public:
-    MemPoolT() : _blockPtrs(), _root(0), _currentAllocs(0), _nAllocs(0), _maxAllocs(0), _nUntracked(0)	{}
+    MemPoolT() : _blocks(), _root(0), _currentAllocs(0), _nAllocs(0), _maxAllocs(0), _nUntracked(0),
+        _itemsPerBlock(ITEMS_PER_BLOCK), _capacity(0)	{}
     ~MemPoolT() {
         Clear();
     }
     
     void Clear() {
         // Delete the blocks.
-        while( !_blockPtrs.Empty()) {
-            Block* lastBlock = _blockPtrs.Pop();
-            delete lastBlock;
+        while( !_blocks.Empty()) {
+            Block lastBlock = _blocks.Pop();
+            if ( lastBlock.allocator ) {
+                lastBlock.allocator->Free( lastBlock.items, lastBlock.count * sizeof( Item ) );
+            }
+            else {
+                delete [] lastBlock.items;
+            }
         }
+        _capacity = 0;
         _root = 0;
         _currentAllocs = 0;
         _nAllocs = 0;
@@ -356,6 +461,34 @@ public:
         _nUntracked = 0;
     }
 
+    /**
+        Marks every item free while keeping the blocks, so later
+        allocations reuse them. Only valid when no item is in use
+        any more, even a dead one left behind by a failed parse.
+    */
+    void Reset() {
+        _root = 0;
+        for( int b = _blocks.Size() - 1; b >= 0; --b ) {
+            Item* blockItems = _blocks[b].items;
+            for( int i = _blocks[b].count - 1; i >= 0; --i ) {
+                blockItems[i].next = _root;
+                _root = &blockItems[i];
+            }
+        }
+        _currentAllocs = 0;
+        _nUntracked = 0;
+    }
+
+    void Stats( XMLPoolStats* stats ) const {
+        stats->itemSize = ITEM_SIZE;
+        stats->currentAllocs = _currentAllocs;
+        stats->untracked = _nUntracked;
+        stats->totalAllocs = _nAllocs;
+        stats->maxAllocs = _maxAllocs;
+        stats->blocks = _blocks.Size();
+        stats->capacity = Capacity();
+    }
+
     virtual int ItemSize() const	{
         return ITEM_SIZE;
     }
@@ -366,14 +499,23 @@ public:
     virtual void* Alloc() {
         if ( !_root ) {
             // Need a new block.
-            Block* block = new Block();
-            _blockPtrs.Push( block );
+            Block block;
+            block.count = _itemsPerBlock;
+            block.allocator = _allocator;
+            if ( _allocator ) {
+                block.items = static_cast<Item*>( _allocator->Allocate( block.count * sizeof( Item ) ) );
+            }
+            else {
+                block.items = new Item[block.count];
+            }
+            _blocks.Push( block );
+            _capacity += block.count * sizeof( Item );
 
-            Item* blockItems = block->items;
-            for( int i = 0; i < ITEMS_PER_BLOCK - 1; ++i ) {
+            Item* blockItems = block.items;
+            for( int i = 0; i < block.count - 1; ++i ) {
                 blockItems[i].next = &(blockItems[i + 1]);
             }
-            blockItems[ITEMS_PER_BLOCK - 1].next = 0;
+            blockItems[block.count - 1].next = 0;
             _root = blockItems;
         }
         Item* const result = _root;
@@ -404,7 +546,7 @@ public:
     void Trace( const char* name ) {
         printf( "Mempool %s watermark=%d [%dk] current=%d size=%d nAlloc=%d blocks=%d\n",
                 name, _maxAllocs, _maxAllocs * ITEM_SIZE / 1024, _currentAllocs,
-                ITEM_SIZE, _nAllocs, _blockPtrs.Size() );
+                ITEM_SIZE, _nAllocs, _blocks.Size() );
     }
 
     void SetTracked() {
@@ -415,6 +557,17 @@ public:
         return _nUntracked;
     }
 
+    /// Bytes held in blocks, whether or not their items are in use.
+    size_t Capacity() const {
+        return _capacity;
+    }
+
+    /// Size of the blocks allocated from now on, ITEMS_PER_BLOCK items by default.
+    void SetBlockSize( size_t bytes ) {
+        const size_t items = bytes / sizeof( Item );
+        _itemsPerBlock = items < 1 ? 1 : items > INT_MAX ? INT_MAX : (int)items;
+    }
+
 	// This number is perf sensitive. 4k seems like a good tradeoff on my machine.
 	// The test file is large, 170k.
 	// Release:		VS2010 gcc(no opt)
@@ -437,15 +590,19 @@ private:
         char    itemData[ITEM_SIZE];
     };
     struct Block {
-        Item items[ITEMS_PER_BLOCK];
+        Item*			items;
+        int				count;
+        XMLAllocator*	allocator;	// the items came from, 0 for new[]
     };
-    DynArray< Block*, 10 > _blockPtrs;
+    DynArray< Block, 10 > _blocks;
     Item* _root;
 
     int _currentAllocs;
     int _nAllocs;
     int _maxAllocs;
     int _nUntracked;
+    int _itemsPerBlock;
+    size_t _capacity;
 };
 
 
@@ -1216,7 +1373,7 @@ public:
 private:
     enum { BUF_SIZE = 200 };
 
-    XMLAttribute() : _name(), _value(),_parseLineNum( 0 ), _next( 0 ), _memPool( 0 ) {}
+    XMLAttribute() : _name(), _value(),_parseLineNum( 0 ), _nameHash( 0 ), _next( 0 ), _memPool( 0 ) {}
     virtual ~XMLAttribute()	{}
 
     XMLAttribute( const XMLAttribute& );	// not supported
@@ -1228,6 +1385,7 @@ private:
     mutable StrPair _name;
     mutable StrPair _value;
     int             _parseLineNum;
+    unsigned        _nameHash;      // set once the element indexes its attributes
     XMLAttribute*   _next;
     MemPool*        _memPool;
 };
@@ -1365,6 +1523,16 @@ public:
         return a->QueryFloatValue( value );
     }
 
+    /** Given the names of three attributes, such as "x", "y" and "z",
+    	QueryFloatTriple() converts them into values[0], values[1] and
+    	values[2] in a single pass over the attributes. Attributes that
+    	are missing or can't be converted leave their value unchanged, so
+    	it can hold a default. Returns XML_SUCCESS when all three were
+    	converted, XML_WRONG_ATTRIBUTE_TYPE if some can't be, or else
+    	XML_NO_ATTRIBUTE if some don't exist.
+    */
+    XMLError QueryFloatTriple( const char* name0, const char* name1, const char* name2, float* values ) const;
+
 	/// See QueryIntAttribute()
 	XMLError QueryStringAttribute(const char* name, const char** value) const {
 		const XMLAttribute* a = FindAttribute(name);
@@ -1627,12 +1795,21 @@ private:
     static void DeleteAttribute( XMLAttribute* attribute );
     XMLAttribute* CreateAttribute();
 
+    struct AttributeIndex;
+    void IndexAttribute( XMLAttribute* attrib );
+    void BuildAttributeIndex();
+    void FreeAttributeIndex();
+    static void FreeAttributeIndex( AttributeIndex* index );
+
     enum { BUF_SIZE = 200 };
     ElementClosingType _closingType;
     // The attribute list is ordered; there is no 'lastAttribute'
     // because the list needs to be scanned for dupes before adding
     // a new attribute.
     XMLAttribute* _rootAttribute;
+    // Hash table over the attributes once there are
+    // TINYXML2_ATTRIBUTE_INDEX_THRESHOLD of them, 0 before.
+    AttributeIndex* _attributeIndex;
 };
 
 
@@ -1703,6 +1880,25 @@ public:
     */
     XMLError LoadFile( FILE* );
 
+    /**
+    	Load an XML file from disk by mapping it instead of
+    	reading it into a buffer. The mapping is private and
+    	copy-on-write, so the file is parsed in place without
+    	being changed, and it is released with the document
+    	(on Clear() or destruction). The file must not be
+    	truncated while the document lives. Where mapping is
+    	not available this is the same as LoadFile().
+
+    	A page is copied when the parser first writes to it.
+    	Names are terminated in place while parsing, so for
+    	typical documents nearly every page is copied, and
+    	memory use ends up about the same as LoadFile().
+
+    	Returns XML_SUCCESS (0) on success, or
+    	an errorID.
+    */
+    XMLError MapFile( const char* filename );
+
     /**
     	Save the XML file to disk.
     	Returns XML_SUCCESS (0) on success, or
@@ -1809,7 +2005,10 @@ public:
     void DeleteNode( XMLNode* node );
 
     void ClearError() {
-        SetError(XML_SUCCESS, 0, 0);
+        // The message of a success never changes, so it is only formatted once
+        if ( _errorID != XML_SUCCESS || _errorLineNum != 0 || _errorStr.Empty() ) {
+            SetError(XML_SUCCESS, 0, 0);
+        }
     }
 
     /// Return true if there was an error parsing the document.
@@ -1840,6 +2039,65 @@ public:
     /// Clear the document, resetting it to the initial state.
     void Clear();
 
+    /**
+    	Bytes of memory held by the document: the blocks of
+    	its node pools plus the buffer holding the parsed text.
+    */
+    size_t MemoryUsage() const;
+
+    /**
+    	When set, Clear() keeps the buffer of the parsed text for
+    	the next LoadFile() or Parse() (a larger one replaces it),
+    	and frees every pool item while keeping the blocks, even
+    	after a failed parse. Parsing the same or a smaller file
+    	again then allocates nothing but what entities or
+    	whitespace processing need. Memory is only given back by
+    	SetRetainMemory( false ) or the destructor. Mapped text
+    	(see MapFile()) is never kept.
+    */
+    void SetRetainMemory( bool retain );
+    bool RetainMemory() const {
+        return _retainMemory;
+    }
+
+    /// Node pools of the document, see PoolStats().
+    enum Pool {
+        ELEMENT_POOL,
+        ATTRIBUTE_POOL,
+        TEXT_POOL,
+        COMMENT_POOL
+    };
+
+    /// Usage of one of the node pools.
+    void PoolStats( Pool pool, XMLPoolStats* stats ) const;
+
+    /**
+    	Sets the size of the blocks the node pools allocate from
+    	now on, 4 KB by default. Large documents are parsed with
+    	fewer allocations, and their nodes kept closer together,
+    	in larger blocks.
+    */
+    void SetPoolBlockSize( size_t bytes );
+
+    /**
+    	Makes the node pools allocate their blocks, and nodes the
+    	strings set through the API, from allocator from now on,
+    	or with new[] again for 0. What was allocated before is
+    	still given back where it came from, so the allocator must
+    	outlive the document (see XMLArena).
+
+    	An XMLArena never gets memory back from Free(): every string
+    	set through the API, and every one replaced, stays in the
+    	arena until it is released. Documents edited for a long time
+    	grow with every change, so use an arena for documents that
+    	are loaded, read and thrown away. Error strings do not count
+    	here; they always come from new[].
+    */
+    void SetAllocator( XMLAllocator* allocator );
+    XMLAllocator* Allocator() const {
+        return _elementPool.Allocator();
+    }
+
 	/**
 		Copies this document to a target document.
 		The target will be completely cleared before the copy.
@@ -1873,6 +2131,9 @@ private:
     mutable StrPair	_errorStr;
     int             _errorLineNum;
     char*			_charBuffer;
+    size_t			_charBufferSize;
+    bool			_charBufferMapped;	// _charBuffer is a file mapping, see MapFile()
+    bool			_retainMemory;
     int				_parseCurLineNum;
 	// Memory tracking does add some overhead.
 	// However, the code assumes that you don't
@@ -1886,10 +2147,16 @@ private:
     MemPoolT< sizeof(XMLAttribute) > _attributePool;
     MemPoolT< sizeof(XMLText) >		 _textPool;
     MemPoolT< sizeof(XMLComment) >	 _commentPool;
+    // Every attribute index of the document's elements, so that those of
+    // elements a failed parse left in the pools can still be freed.
+    XMLElement::AttributeIndex* _attributeIndexes;
 
 	static const char* _errorNames[XML_ERROR_COUNT];
 
     void Parse();
+    void FreeAttributeIndexes();
+    char* AllocCharBuffer( size_t size );
+    void FreeCharBuffer();
 
     void SetError( XMLError error, int lineNum, const char* format, ... );
 
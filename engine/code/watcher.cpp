@@ -0,0 +1,155 @@
+#include <map>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <filesystem>
+#include <cstdint>
+#include "watcher.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+static mutex watchMutex;
+static map<string, string> watched;			// absolute path -> path as given
+static map<string, int> directories;		// absolute directory -> watch descriptor
+static map<int, string> descriptors;		// watch descriptor -> absolute directory
+static WatchCallback callback;
+static int inotifyFd = -1;
+static int stopFd = -1;					// written by watchStop to wake the thread
+static thread watchThread;
+
+static string absolutePath(const string& file)
+{
+	error_code error;
+	filesystem::path path = filesystem::absolute(file, error);
+	return error ? file : path.lexically_normal().string();
+}
+
+void watchFiles(const vector<string>& files)
+{
+#ifdef __linux__
+	lock_guard<mutex> lock(watchMutex);
+	watched.clear();
+	for (const string& file : files)
+	{
+		string path = absolutePath(file);
+		watched[path] = file;
+
+		// Directories stay watched once added, they are few
+		string directory = filesystem::path(path).parent_path().string();
+		if (directories.count(directory))
+			continue;
+
+		int wd = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (wd >= 0)
+		{
+			directories[directory] = wd;
+			descriptors[wd] = directory;
+		}
+	}
+#endif
+}
+
+#ifdef __linux__
+// Reads the pending events, adding the watched files they touch to changed
+static void readEvents(set<string>& changed)
+{
+	alignas(inotify_event) char buffer[16 * 1024];
+	ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+
+	lock_guard<mutex> lock(watchMutex);
+	for (ssize_t offset = 0; offset < length; )
+	{
+		const inotify_event* event = (const inotify_event*)(buffer + offset);
+		offset += sizeof(inotify_event) + event->len;
+
+		map<int, string>::iterator directory = descriptors.find(event->wd);
+		if (event->len == 0 || directory == descriptors.end())
+			continue;
+
+		string path = (filesystem::path(directory->second) / event->name).string();
+		map<string, string>::iterator file = watched.find(path);
+		if (file != watched.end())
+			changed.insert(file->second);
+	}
+}
+
+static void watchLoop()
+{
+	pollfd fds[2] = { { inotifyFd, POLLIN, 0 }, { stopFd, POLLIN, 0 } };
+	for (;;)
+	{
+		set<string> changed;
+		if (poll(fds, 2, -1) <= 0)
+			continue;
+		if (fds[1].revents)
+			return;
+		readEvents(changed);
+
+		// Files are often written in several steps, wait for them to settle
+		while (poll(fds, 2, WATCH_SETTLE_MS) > 0)
+		{
+			if (fds[1].revents)
+				return;
+			readEvents(changed);
+		}
+
+		if (!changed.empty())
+			callback(vector<string>(changed.begin(), changed.end()));
+	}
+}
+#endif
+
+bool watchStart(const vector<string>& files, WatchCallback changed)
+{
+#ifdef __linux__
+	inotifyFd = inotify_init1(IN_CLOEXEC);
+	if (inotifyFd < 0)
+		return false;
+	stopFd = eventfd(0, EFD_CLOEXEC);
+	if (stopFd < 0)
+	{
+		close(inotifyFd);
+		inotifyFd = -1;
+		return false;
+	}
+
+	callback = changed;
+	watchFiles(files);
+
+	watchThread = thread(watchLoop);
+	return true;
+#else
+	return false;
+#endif
+}
+
+void watchStop()
+{
+#ifdef __linux__
+	if (!watchThread.joinable())
+		return;
+
+	uint64_t one = 1;
+	if (write(stopFd, &one, sizeof(one)) != sizeof(one))
+	{
+		watchThread.detach();
+		return;
+	}
+	watchThread.join();
+
+	close(stopFd);
+	close(inotifyFd);
+	stopFd = inotifyFd = -1;
+	lock_guard<mutex> lock(watchMutex);
+	watched.clear();
+	directories.clear();
+	descriptors.clear();
+#endif
+}
@@ -0,0 +1,34 @@
+#ifndef WATCHER_H
+#define WATCHER_H
+
+#include <vector>
+#include <string>
+#include <functional>
+
+/*
+* File watcher for hot reload, built on inotify (Linux only; elsewhere
+* watchStart fails and nothing is watched).
+*
+* The directories of the watched files are watched rather than the files
+* themselves, so files replaced by a rename (as many editors, and the
+* generator through writeModel, do) keep being noticed. Only files closed after writing or
+* renamed into place count, never writes still in progress. Changes are
+* collected on a background thread until WATCH_SETTLE_MS pass without new
+* ones, and then reported in one batch, on that same thread, with the
+* paths as they were given.
+*/
+
+#define WATCH_SETTLE_MS 50
+
+typedef std::function<void(const std::vector<std::string>&)> WatchCallback;
+
+// Starts the watcher thread, false if file watching isn't available
+bool watchStart(const std::vector<std::string>& files, WatchCallback changed);
+
+// Replaces the set of watched files, from any thread
+void watchFiles(const std::vector<std::string>& files);
+
+// Stops the watcher thread and waits for a batch being reported to finish
+void watchStop();
+
+#endif
@@ -0,0 +1,347 @@
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string_view>
+#include "xmlstream.h"
+
+using namespace std;
+
+bool isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+void encodeUTF8(unsigned long code, char*& out)
+{
+	if (code < 0x80)
+	{
+		*out++ = (char)code;
+	}
+	else if (code < 0x800)
+	{
+		*out++ = (char)(0xC0 | (code >> 6));
+		*out++ = (char)(0x80 | (code & 0x3F));
+	}
+	else if (code < 0x10000)
+	{
+		*out++ = (char)(0xE0 | (code >> 12));
+		*out++ = (char)(0x80 | ((code >> 6) & 0x3F));
+		*out++ = (char)(0x80 | (code & 0x3F));
+	}
+	else
+	{
+		*out++ = (char)(0xF0 | (code >> 18));
+		*out++ = (char)(0x80 | ((code >> 12) & 0x3F));
+		*out++ = (char)(0x80 | ((code >> 6) & 0x3F));
+		*out++ = (char)(0x80 | (code & 0x3F));
+	}
+}
+
+void decodeEntities(char* value)
+{
+	/*
+	* Replaces the predefined and numeric entities in place; the decoded
+	* text is never longer. Unknown entities are kept as written, like
+	* tinyxml2 does.
+	*/
+	static const pair<const char*, char> entities[] = {
+		{ "amp", '&' }, { "lt", '<' }, { "gt", '>' }, { "quot", '"' }, { "apos", '\'' }
+	};
+
+	char* out = value;
+	for (char* in = value; *in; )
+	{
+		char* semicolon = *in == '&' ? strchr(in, ';') : NULL;
+		if (semicolon == NULL)
+		{
+			*out++ = *in++;
+			continue;
+		}
+
+		string_view entity(in + 1, semicolon - in - 1);
+		bool decoded = false;
+		if (entity.size() > 1 && entity[0] == '#')
+		{
+			bool hex = entity[1] == 'x';
+			char* digitsEnd;
+			unsigned long code = strtoul(in + (hex ? 3 : 2), &digitsEnd, hex ? 16 : 10);
+			if (digitsEnd == semicolon && code > 0 && code <= 0x10FFFF)
+			{
+				encodeUTF8(code, out);
+				decoded = true;
+			}
+		}
+		else
+		{
+			for (const pair<const char*, char>& e : entities)
+			{
+				if (entity == e.first)
+				{
+					*out++ = e.second;
+					decoded = true;
+					break;
+				}
+			}
+		}
+
+		if (decoded)
+			in = semicolon + 1;
+		else
+			*out++ = *in++;
+	}
+	*out = '\0';
+}
+
+XMLStream::~XMLStream()
+{
+	close();
+}
+
+bool XMLStream::open(const char* fileName)
+{
+	close();
+	file = fopen(fileName, "rb");
+	if (file == NULL)
+		return false;
+
+	buffer.resize(XML_STREAM_BUFFER);
+	begin = 0;
+	end = 0;
+	eof = false;
+	closePending = false;
+	rootSeen = false;
+	name = "";
+	attributes.clear();
+	openCount = 0;
+	return true;
+}
+
+void XMLStream::close()
+{
+	if (file != NULL)
+		fclose(file);
+	file = NULL;
+}
+
+bool XMLStream::fill()
+{
+	// Moves what is left to the front and reads after it, growing the buffer only when it is full
+	if (eof)
+		return false;
+
+	if (begin > 0)
+	{
+		memmove(buffer.data(), buffer.data() + begin, end - begin);
+		end -= begin;
+		begin = 0;
+	}
+	if (end == buffer.size())
+		buffer.resize(buffer.size() * 2);
+
+	size_t read = fread(buffer.data() + end, 1, buffer.size() - end, file);
+	end += read;
+	eof = read == 0;
+	return read > 0;
+}
+
+bool XMLStream::find(const char* token, size_t from, size_t& at)
+{
+	// Offsets are relative to begin, which fill may move
+	size_t length = strlen(token);
+	for (;;)
+	{
+		string_view available(buffer.data() + begin, end - begin);
+		at = available.find(token, from);
+		if (at != string_view::npos)
+			return true;
+
+		if (available.size() >= length)
+			from = max(from, available.size() - length + 1);
+		if (!fill())
+			return false;
+	}
+}
+
+bool XMLStream::findTagEnd(size_t& at)
+{
+	// The first '>' outside quoted attribute values
+	char quote = 0;
+	for (at = 1; ; )
+	{
+		const char* s = buffer.data() + begin;
+		for (; at < end - begin; at++)
+		{
+			char c = s[at];
+			if (quote != 0)
+			{
+				if (c == quote)
+					quote = 0;
+			}
+			else if (c == '"' || c == '\'')
+			{
+				quote = c;
+			}
+			else if (c == '>')
+			{
+				return true;
+			}
+		}
+		if (!fill())
+			return false;
+	}
+}
+
+bool XMLStream::readStart(size_t tagEnd)
+{
+	// Splits the tag in place: names and values are terminated where they end
+	char* p = buffer.data() + begin + 1;
+	char* last = buffer.data() + begin + tagEnd;
+	bool selfClosing = last > p && last[-1] == '/';
+	if (selfClosing)
+		last--;
+	*last = '\0';
+
+	char* elementName = p;
+	while (p < last && !isSpace(*p))
+		p++;
+	if (p == elementName)
+		return false;
+	if (p < last)
+		*p++ = '\0';
+
+	for (;;)
+	{
+		while (p < last && isSpace(*p))
+			p++;
+		if (p >= last)
+			break;
+
+		char* attributeName = p;
+		while (p < last && !isSpace(*p) && *p != '=')
+			p++;
+		char* nameEnd = p;
+		while (p < last && isSpace(*p))
+			p++;
+		if (nameEnd == attributeName || p >= last || *p != '=')
+			return false;
+		*nameEnd = '\0';
+		p++;
+
+		while (p < last && isSpace(*p))
+			p++;
+		if (p >= last || (*p != '"' && *p != '\''))
+			return false;
+		char* closing = (char*)memchr(p + 1, *p, last - p - 1);
+		if (closing == NULL)
+			return false;
+		*closing = '\0';
+		decodeEntities(p + 1);
+		attributes.push_back(make_pair(attributeName, p + 1));
+		p = closing + 1;
+	}
+
+	if (openCount == (int)openNames.size())
+		openNames.emplace_back();
+	openNames[openCount++] = elementName;
+	name = elementName;
+	closePending = selfClosing;
+	rootSeen = true;
+	return true;
+}
+
+bool XMLStream::readEnd(size_t tagEnd)
+{
+	char* elementName = buffer.data() + begin + 2;
+	char* last = buffer.data() + begin + tagEnd;
+	while (last > elementName && isSpace(last[-1]))
+		last--;
+	*last = '\0';
+
+	if (openCount == 0 || openNames[openCount - 1] != elementName)
+		return false;
+	openCount--;
+	name = openNames[openCount].c_str();
+	return true;
+}
+
+XMLStreamEvent XMLStream::next()
+{
+	if (file == NULL)
+		return XML_STREAM_FAILED;
+
+	attributes.clear();
+	if (closePending)
+	{
+		closePending = false;
+		openCount--;
+		name = openNames[openCount].c_str();
+		return XML_STREAM_END;
+	}
+
+	for (;;)
+	{
+		// Text up to the next tag is skipped
+		size_t at;
+		if (!find("<", 0, at))
+			return ferror(file) || openCount > 0 || !rootSeen ? XML_STREAM_FAILED : XML_STREAM_DONE;
+		begin += at;
+
+		// Enough to tell what kind of tag it is
+		while (end - begin < 9 && fill())
+			;
+		string_view tag(buffer.data() + begin, end - begin);
+
+		size_t tagEnd;
+		if (tag.compare(0, 4, "<!--") == 0)
+		{
+			if (!find("-->", 4, tagEnd))
+				return XML_STREAM_FAILED;
+			begin += tagEnd + 3;
+		}
+		else if (tag.compare(0, 9, "<![CDATA[") == 0)
+		{
+			if (!find("]]>", 9, tagEnd))
+				return XML_STREAM_FAILED;
+			begin += tagEnd + 3;
+		}
+		else if (tag.compare(0, 2, "<?") == 0)
+		{
+			if (!find("?>", 2, tagEnd))
+				return XML_STREAM_FAILED;
+			begin += tagEnd + 2;
+		}
+		else if (tag.compare(0, 2, "<!") == 0)
+		{
+			// Declarations such as DOCTYPE, without an internal subset
+			if (!findTagEnd(tagEnd))
+				return XML_STREAM_FAILED;
+			begin += tagEnd + 1;
+		}
+		else
+		{
+			if (!findTagEnd(tagEnd))
+				return XML_STREAM_FAILED;
+
+			bool closing = buffer[begin + 1] == '/';
+			if (closing ? !readEnd(tagEnd) : !readStart(tagEnd))
+				return XML_STREAM_FAILED;
+			begin += tagEnd + 1;
+			return closing ? XML_STREAM_END : XML_STREAM_START;
+		}
+	}
+}
+
+const char* XMLStream::Attribute(const char* attributeName) const
+{
+	for (const pair<const char*, const char*>& a : attributes)
+	{
+		if (strcmp(a.first, attributeName) == 0)
+			return a.second;
+	}
+	return NULL;
+}
+
+size_t XMLStream::memoryUsage() const
+{
+	return buffer.capacity() + attributes.capacity() * sizeof(attributes[0]) + openNames.capacity() * sizeof(string);
+}
@@ -0,0 +1,86 @@
+#ifndef XMLSTREAM_H
+#define XMLSTREAM_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <vector>
+#include <string>
+
+/*
+* Pull parser for XML files too large to hold as a tinyxml2 document.
+*
+* The file is read through a buffer of XML_STREAM_BUFFER bytes (grown only
+* for a tag that doesn't fit), and every call to next() reports the next
+* element start or end; text, comments, declarations and CDATA are
+* skipped. A self-closing element is reported as a start followed by an
+* end. Name() and Attribute() have the meaning of their XMLElement
+* namesakes, so scene readers can take either, and stay valid until the
+* next call to next().
+*
+* Nesting is checked as the file is read, so a malformed file is only
+* found out once the parser gets there: callers must be ready to drop
+* what they built before next() returns XML_STREAM_FAILED.
+*/
+
+#define XML_STREAM_BUFFER	(64 * 1024)
+
+enum XMLStreamEvent
+{
+	XML_STREAM_START,
+	XML_STREAM_END,
+	XML_STREAM_DONE,		// end of the file after a complete root element
+	XML_STREAM_FAILED		// malformed XML or a read error
+};
+
+class XMLStream
+{
+public:
+	XMLStream() {};
+	~XMLStream();
+	XMLStream(const XMLStream&) = delete;
+	XMLStream& operator=(const XMLStream&) = delete;
+
+	bool open(const char* fileName);
+	void close();
+
+	XMLStreamEvent next();
+
+	// Name of the element just started or ended
+	const char* Name() const
+	{
+		return name;
+	}
+
+	// Value of an attribute of the element just started, NULL if it has none
+	const char* Attribute(const char* attributeName) const;
+
+	// Elements open around the current position, the current one included
+	int depth() const
+	{
+		return openCount;
+	}
+
+	// Bytes held by the buffer and the element stack
+	size_t memoryUsage() const;
+
+private:
+	FILE* file = NULL;
+	std::vector<char> buffer;
+	size_t begin = 0;				// first byte not consumed yet
+	size_t end = 0;					// one past the last byte read
+	bool eof = false;
+	bool closePending = false;		// the last start was self-closing
+	bool rootSeen = false;
+	const char* name = "";
+	std::vector<std::pair<const char*, const char*>> attributes;
+	std::vector<std::string> openNames;	// names of the open elements, reused as it grows
+	int openCount = 0;
+
+	bool fill();
+	bool find(const char* token, size_t from, size_t& at);
+	bool findTagEnd(size_t& at);
+	bool readStart(size_t tagEnd);
+	bool readEnd(size_t tagEnd);
+};
+
+#endif
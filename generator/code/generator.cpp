@@ -1,520 +1,215 @@
-#define _USE_MATH_DEFINES
-#define M_PI	3.14159265358979323846
-
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <string>
-#include <math.h>
+#include <sstream>
+#include <filesystem>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <functional>
+#include <cstdint>
+#include "primitives.h"
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
 
 using namespace std;
 
-class Point {
+int primitiveCode(const string& primitive)
+{
+	if (primitive == "plane")	return 1;
+	if (primitive == "box")		return 2;
+	if (primitive == "sphere")	return 3;
+	if (primitive == "cone")	return 4;
+	if (primitive == "cylinder") return 5;
+	return 0;
+}
+
+/*
+* Version of the model file format written by the primitives above. Bump it
+* whenever their output changes so that stale cache entries stop matching.
+*/
+#define MODEL_FORMAT_VERSION 1
+
+atomic<int> cacheHits(0);
+
+class Fingerprint
+{
 public:
-	float x;
-	float y;
-	float z;
+	// 64-bit FNV-1a over everything that determines a generated file
+	uint64_t value = 14695981039346656037ull;
+
+	void add(const void* data, size_t size)
+	{
+		const unsigned char* bytes = (const unsigned char*)data;
+		for (size_t i = 0; i < size; i++)
+		{
+			value ^= bytes[i];
+			value *= 1099511628211ull;
+		}
+	}
+
+	void add(const string& s)
+	{
+		add(s.c_str(), s.length() + 1);
+	}
+
+	void add(int v)
+	{
+		add(&v, sizeof(v));
+	}
 
-	Point() {};
-	Point(float xCoord, float yCoord, float zCoord)
+	void add(float v)
 	{
-		x = xCoord;
-		y = yCoord;
-		z = zCoord;
+		add(&v, sizeof(v));
 	}
 
 	string toString()
 	{
-		return to_string(x) + " " + to_string(y) + " " + to_string(z);
+		char hex[17];
+		snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)value);
+		return hex;
 	}
 };
 
-void writePoint(Point p, ofstream& file)
-{
-	string point = p.toString();
-	file.write(point.c_str(), point.length() + 1);
-}
-
-void writeSquare(Point p1, Point p2, Point p3, Point p4, ofstream& file)
+filesystem::path cacheDirectory()
 {
 	/*
-	* Writes the points of the two triangles that form a square which points
-	* are given in the same order as we read a book (left-right, top-bottom)
-	*	 p1		 p2
-	*	  ___
-	*	 |  /  /|
-	*	 | /  / |
-	*	 |/  /__|
-	*	 p3     p4
+	* The cache is off unless GENERATOR_CACHE_DIR names a directory for it
+	* (.generator_cache is the usual choice). Entries are never pruned, so
+	* the directory has to be deleted by hand to reclaim its space.
 	*/
-
-	// First triangle
-	writePoint(p1, file);
-	writePoint(p3, file);
-	writePoint(p2, file);
-
-	// Second triangle
-	writePoint(p3, file);
-	writePoint(p4, file);
-	writePoint(p2, file);
+	const char* dir = getenv("GENERATOR_CACHE_DIR");
+	if (dir == NULL)
+		return "";
+	return dir;
 }
 
-
-void plane(int length, int division, char* fileName)
+filesystem::path temporaryFile(const filesystem::path& target)
 {
-	ofstream file(fileName, ios::binary | ios::out);
-
-	/*
-	* Draw strategy:
-	* The idea is to draw a 2D square using
-	* the points estimated as follows:
-	*       X
-	*       ^
-	* p1----|----p2
-	* |     |    |
-	* |     -----|--> Z
-	* |          |
-	* p3---------p4
-	*
-	* Since the plane is always centered on the origin, its vertices
-	* are located at half the side length from the origin.
-	*/
-
-	float v = (float)length / 2; // value of the coordinate for all the corner vertices
-
-	Point p1 = {  v, 0, -v };
-	Point p2 = {  v, 0,  v };
-	Point p3 = { -v, 0, -v };
-	Point p4 = { -v, 0,  v };
-
-	float inc = (float)length / division; // increment for internal vertices
-
-	Point x1, x2, x3, x4; // temp points to use when building sub-faces
-
-	for (int i = 0; i < division; i++)
-	{
-		for (int j = 0; j < division; j++)
-		{
-			/*
-			* x1-----x2
-			* |      |
-			* |      |
-			* x3-----x4
-			* p3
-			*/
-			x1 = { p3.x + inc * (1 + i), p3.y, p3.z + inc * j       };
-			x2 = { p3.x + inc * (1 + i), p3.y, p3.z + inc * (1 + j) };
-			x3 = { p3.x + inc * i      , p3.y, p3.z + inc * j       };
-			x4 = { p3.x + inc * i      , p3.y, p3.z + inc * (1 + j) };
-
-			writeSquare(x1, x2, x3, x4, file);
-		}
-	}
-
-	file.close();
+	// Next to the target, so that a rename can replace it, and private to the process and thread
+	ostringstream name;
+	name << target.filename().string() << "." << getpid() << "." << this_thread::get_id() << ".tmp";
+	return target.parent_path() / name.str();
 }
 
-
-void box(int length, int division, char* fileName)
+bool linkOutput(const filesystem::path& cached, const string& fileName)
 {
-	ofstream file(fileName, ios::binary | ios::out);
-
 	/*
-	* Draw strategy:
-	* The idea is to draw 2D squares for each side of the box using
-	* the corresponding points estimated as follows:
-	*     p5-------p6
-	*   /  |       /|
-	*  /   |      / |
-	* p1---|-----p2 |
-	* |    |     |  |
-	* |   p7-----|-p8
-	* | /        | /
-	* p3---------p4
-	*
-	* Since the box is always centered on the origin, its vertices
-	* are located at half the side length from the origin.
+	* The output becomes another name of the cache entry, which is never
+	* written again, and replaces the old output in one rename. A copy is
+	* only made when the two are on different file systems.
 	*/
-
-	float v = (float)length / 2; // value of the coordinate for all the box corner vertices
-	
-	Point p1 = {-v,  v,  v};
-	Point p2 = { v,  v,  v};
-	Point p3 = {-v, -v,  v};
-	Point p4 = { v, -v,  v};
-	Point p5 = {-v,  v, -v};
-	Point p6 = { v,  v, -v};
-	Point p7 = {-v, -v, -v};
-	Point p8 = { v, -v, -v};
-
-	float inc = (float)length / division; // increment for internal vertices
-
-	Point x1, x2, x3, x4; // temp points to use when building faces
-
-	// Top Face
-	for (int i = 0; i < division; i++)
+	error_code ec;
+	if (!filesystem::equivalent(cached, fileName, ec) || ec)
 	{
-		for (int j = 0; j < division; j++)
+		// Renaming over another name of the same file does nothing, so that case is skipped
+		filesystem::path tmp = temporaryFile(fileName);
+		ec.clear();
+		filesystem::remove(tmp, ec);
+		filesystem::create_hard_link(cached, tmp, ec);
+		if (ec)
+			filesystem::copy_file(cached, tmp, filesystem::copy_options::overwrite_existing, ec);
+		if (!ec)
+			filesystem::rename(tmp, fileName, ec);
+		if (ec)
 		{
-			/*
-			* x1-----x2
-			* |      |
-			* |      |
-			* x3-----x4
-			* p6
-			*/
-			x1 = { p6.x - inc * i      , p6.y, p6.z + inc * (1 + j) };
-			x2 = { p6.x - inc * (1 + i), p6.y, p6.z + inc * (1 + j) };
-			x3 = { p6.x - inc * i      , p6.y, p6.z + inc * j       };
-			x4 = { p6.x - inc * (1 + i), p6.y, p6.z + inc * j       };
-
-			writeSquare(x1, x2, x3, x4, file);
+			error_code ignored;
+			filesystem::remove(tmp, ignored);
+			return false;
 		}
 	}
 
-	// Down Face
-	for (int i = 0; i < division; i++)
-	{
-		for (int j = 0; j < division; j++)
-		{
-			/*
-			* x1-----x2
-			* |      |
-			* |      |
-			* x3-----x4
-			* p7
-			*/
-			x1 = { p7.x + inc * i      , p7.y, p7.z + inc * (1 + j) };
-			x2 = { p7.x + inc * (1 + i), p7.y, p7.z + inc * (1 + j) };
-			x3 = { p7.x + inc * i      , p7.y, p7.z + inc * j       };
-			x4 = { p7.x + inc * (1 + i), p7.y, p7.z + inc * j       };
-
-			writeSquare(x1, x2, x3, x4, file);
-		}
-	}
+	// A link keeps the cache entry's time; the output counts as written now for upToDate
+	filesystem::last_write_time(fileName, filesystem::file_time_type::clock::now(), ec);
+	return !ec;
+}
 
-	// Front Face
-	for (int i = 0; i < division; i++)
+void generateCached(Fingerprint key, const function<void(const char*)>& build, const string& fileName)
+{
+	filesystem::path dir = cacheDirectory();
+	if (dir.empty())
 	{
-		for (int j = 0; j < division; j++)
-		{
-			/*
-			* x1-----x2
-			* |      |
-			* |      |
-			* x3-----x4
-			* p3
-			*/
-			x1 = { p3.x + inc * i      , p3.y + inc * (1 + j) , p3.z };
-			x2 = { p3.x + inc * (1 + i), p3.y + inc * (1 + j) , p3.z };
-			x3 = { p3.x + inc * i      , p3.y + inc * j       , p3.z };
-			x4 = { p3.x + inc * (1 + i), p3.y + inc * j       , p3.z };
-
-			writeSquare(x1, x2, x3, x4, file);
-		}
+		build(fileName.c_str());
+		return;
 	}
 
-	// Rear Face
-	for (int i = 0; i < division; i++)
-	{
-		for (int j = 0; j < division; j++)
-		{
-			/*
-			* x1-----x2
-			* |      |
-			* |      |
-			* x3-----x4
-			* p8
-			*/
-			x1 = { p8.x - inc * i      , p8.y + inc * (1 + j) , p8.z };
-			x2 = { p8.x - inc * (1 + i), p8.y + inc * (1 + j) , p8.z };
-			x3 = { p8.x - inc * i      , p8.y + inc * j       , p8.z };
-			x4 = { p8.x - inc * (1 + i), p8.y + inc * j       , p8.z };
-
-			writeSquare(x1, x2, x3, x4, file);
-		}
-	}
+	error_code ec;
+	filesystem::path cached = dir / (key.toString() + ".model");
 
-	// Right Face
-	for (int i = 0; i < division; i++)
+	if (!filesystem::exists(cached, ec))
 	{
-		for (int j = 0; j < division; j++)
+		// Build into a private temporary and publish it with a rename, so that
+		// concurrent builds of the same primitive never see a partial file
+		filesystem::create_directories(dir, ec);
+		filesystem::path tmp = temporaryFile(cached);
+
+		build(tmp.string().c_str());
+		filesystem::rename(tmp, cached, ec);
+		if (ec)
 		{
-			/*
-			* x1-----x2
-			* |      |
-			* |      |
-			* x3-----x4
-			* p4
-			*/
-			x1 = { p4.x, p4.y + inc * (1 + i), p4.z - inc * j };
-			x2 = { p4.x, p4.y + inc * (1 + i), p4.z - inc * (1 + j) };
-			x3 = { p4.x, p4.y + inc * i      , p4.z - inc * j       };
-			x4 = { p4.x, p4.y + inc * i      , p4.z - inc * (1 + j) };
-
-			writeSquare(x1, x2, x3, x4, file);
+			// Cache directory not usable, fall back to a plain build
+			filesystem::remove(tmp, ec);
+			build(fileName.c_str());
+			return;
 		}
 	}
-
-	// Leftface
-	for (int i = 0; i < division; i++)
+	else
 	{
-		for (int j = 0; j < division; j++)
-		{
-			/*
-			* x1-----x2
-			* |      |
-			* |      |
-			* x3-----x4
-			* p7
-			*/
-			x1 = { p7.x, p7.y + inc * (1 + i), p7.z + inc * j };
-			x2 = { p7.x, p7.y + inc * (1 + i), p7.z + inc * (1 + j) };
-			x3 = { p7.x, p7.y + inc * i      , p7.z + inc * j };
-			x4 = { p7.x, p7.y + inc * i      , p7.z + inc * (1 + j) };
-
-			writeSquare(x1, x2, x3, x4, file);
-		}
+		cacheHits++;
 	}
 
-	file.close();
+	if (!linkOutput(cached, fileName))
+		build(fileName.c_str());
 }
 
-void sphere(float radius, int slices, int stacks, char* fileName)
+bool generatePrimitive(const vector<string>& args)
 {
-	// Horizontal Circle
-	float alpha = 0;
-	float alpha_inc = (float)(2 * M_PI) / (float)slices;
-	// Half Vertical Circle
-	float beta = (float)-M_PI / 2;
-	float beta_inc = (float)(M_PI) / (float)stacks;
-
-	Point p1, p2, p3, p4;
-
-	ofstream file(fileName, ios::binary | ios::out);
-
-	for (int i = 1; i < slices + 1; i++) {
-		for (int j = 1; j < stacks + 1; j++) {
-
-			p1 = { radius * cos(beta) * sin(alpha),							radius * sin(beta),				radius * cos(beta) * cos(alpha) };
-			p2 = { radius * cos(beta + beta_inc) * sin(alpha),				radius * sin(beta + beta_inc),	radius * cos(beta + beta_inc) * cos(alpha) };
-			p3 = { radius * cos(beta + beta_inc) * sin(alpha + alpha_inc),	radius * sin(beta + beta_inc),	radius * cos(beta + beta_inc) * cos(alpha + alpha_inc) };
-			p4 = { radius * cos(beta) * sin(alpha + alpha_inc),				radius * sin(beta),				radius * cos(beta) * cos(alpha + alpha_inc) };
-
-			/*
-			*	p2		p3
-			*	  ______
-			*	  \    /
-			*	   \  /
-			*	    \/
-			*	 p4 = p1
-			*   First stack (under) is a triangle
-			*/
-			if (j == 1) {
-				writePoint(p3, file);
-				writePoint(p2, file);
-				writePoint(p1, file);
-			}
-
-			/*
-			*	 p2 = p3
-			*		/\
-			*	   /  \
-			*	  /____\
-			*	p1		p4
-			*	Last stack (top) is a triangle
-			*/
-			else if (j == stacks) {
-				writePoint(p4, file);
-				writePoint(p3, file);
-				writePoint(p1, file);
-			}
-
-			/*
-			*	Sentido do Relgio
-			*	2 +-------+ 3
-			*	  |		 /|
-			*	  |	  /	  |
-			*	  |/	  |
-			*	1 +-------+ 4
-			*/
-			else {
-				writePoint(p4, file);
-				writePoint(p3, file);
-				writePoint(p2, file);
-
-				writePoint(p2, file);
-				writePoint(p1, file);
-				writePoint(p4, file);
-			}
-			beta = (float)-(M_PI / 2) + j * beta_inc;
-		}
-		alpha = i * alpha_inc;
-		beta = (float)-(M_PI / 2);
-	}
-	file.close();
-}
-
-void cone(float radius, float height, int slices, int stacks, char* filename) {
 	/*
-	* Draw strategy:
-	* The idea is to draw 2D circles for different yy positions (corresponding to
-	* the different stacks). Starting from the bottom of the cone (where the circle
-	* should also be drawn), in each iteration we'll be drawing 2 points in the current
-	* circle and 2 points in the upper circle. Those will define the side of the cone.
-	* In the last stack, the upper circle doesn't exist and, instead of 2 points on the
-	* upper side, there will only exist 1 - the top vertice of the cone.
-	*/
-	float alpha = 0; // initial angle to travel through the base perimeter
-	float alpha_inc = (float)(2 * M_PI) / (float)slices; // angle increment to be used in each iteration
-	float h = 0; // initial value of current height
-	float h_inc = (float)height / (float)stacks; // increment of height 
-	float r = radius; // initial value of current radius
-	float new_r; // radius of the circle on top of the current one
-
-	Point p1, p2, p3, p4;
-
-	ofstream file(filename, ios::binary | ios::out);
-
-	for (int i = 1; i < slices + 1; i++) {
-		/*
-		* Triangle in the base (YY coordinate equals to zero)
-		*          x p3 (center of circle)
-		*       /   /
-		*      /    /
-		* p1 /     /
-		*  x      /
-		*    \   /
-		*     \ /
-		*      x  p2
-		*/
-		p1 = { radius * sin(alpha),             0, radius * cos(alpha) };
-		p2 = { radius * sin(alpha + alpha_inc), 0, radius * cos(alpha + alpha_inc) };
-		p3 = { 0,                               0, 0 };
-
-		writePoint(p1, file);
-		writePoint(p3, file);
-		writePoint(p2, file);
-
-		for (int j = 1; j < stacks + 1; j++) {
-
-			/*
-			* To identify the radius of the circle on top of the current one, just need to consider the
-			* triangle that can be draw be cutting the cone in half (either through YZ or XY plane).
-			* Then, just compare the triangle with total cone helgth as vertical side with that having
-			* a vertical side that goes from bottom of cone up to next stack level.
-			* 
-			* 			              From the geometry on the left one gets:
-			*          /|             radius ----- heigth
-			*         / |                r   ----- heigth - (h + h_inc)
-			*        /  |
-			*       /   |             Thus r = radius * (height - (h + h_inc)) / height
-			*      /____| height
-			*     /  r  |
-			*    /      |
-			*   /       |
-			*  ----------
-			*     radius
-			*/
-
-			new_r = (radius * (height - (h + h_inc))) / height;
-
-			/* p3 and p4 are in the current level (YY equal), p1 and p2 are on the upper level(YY equal)
-			*  p1       p2
-			*  x--------x
-			*  |        |
-			*  |        |
-			*  |        |
-			*  |        |
-			*  x--------x
-			*  p3       p4
-			*/
-			p1 = { new_r * sin(alpha)            , h + h_inc, new_r * cos(alpha) };
-			p2 = { new_r * sin(alpha + alpha_inc), h + h_inc, new_r * cos(alpha + alpha_inc) };
-			p3 = { r     * sin(alpha)            ,     h    , r     * cos(alpha) };
-			p4 = { r     * sin(alpha + alpha_inc),     h    , r     * cos(alpha + alpha_inc) };
-
-			writeSquare(p1, p2, p3, p4, file);
-
-			h = j * h_inc;
-			r = new_r;
-		}
-		alpha = i * alpha_inc;
-		h = 0;
-		r = radius;
-	}
-	file.close();
-}
-
-void cylinder(float radius, float height, int slices, char* filename) {
-	/*
-	* Draw strategy:
-	* Since the cylinder will be centered in the origin of its own axis
-	* we'll draw half of it and then multiply by -1 to get the other half.
-	* To do this, we'll loop through cylinder basis angle and, while describing
-	* the circle, draw one slice of the cylinder at a time.
-	* 
-	*  p1       p2
-	*  x--------x
-	*  |        |
-	*  |        |
-	*  |        |
-	*  |        |
-	*  x--------x
-	*  p3       p4
+	* args holds the same tokens as the command line, without the program name:
+	* the primitive name, its parameters and the output file name.
+	*
+	* Each case only parses its parameters and records them in the fingerprint;
+	* the actual build (or the cache lookup) happens once below.
 	*/
-	float alpha = 0; // initial angle to travel through the base perimeter
-	float alpha_inc = (float)(2 * M_PI) / (float)slices; // angle increment to be used in each iteration
-	float halfHeight = (float)height / 2;
+	int argc = (int)args.size() + 1;
+	Fingerprint key;
+	function<void(const char*)> build;
+	string fileName;
 
-	Point topBaseCenter = { 0, halfHeight, 0 };
-	Point botBaseCenter = { 0, -1 * halfHeight, 0 };
+	// Text or binary, chosen from the output file name
+	ModelFormat format = modelFormatFor(args.back());
 
-	Point p1, p2, p3, p4;
-
-	ofstream file(filename, ios::binary | ios::out);
-
-	for (int i = 1; i < slices + 1; i++) {
-		// note that, since we assume that cylinder basis is parallel to XZ plane,
-		// YY coordinate will remain constant in all points (apart from the simmetry)
-		p1 = { radius * (float)sin(alpha),                  halfHeight, radius * (float)cos(alpha) };
-		p2 = { radius * (float)sin(alpha + alpha_inc),      halfHeight, radius * (float)cos(alpha + alpha_inc) };
-		p3 = { radius * (float)sin(alpha),             -1 * halfHeight, radius * (float)cos(alpha) };
-		p4 = { radius * (float)sin(alpha + alpha_inc), -1 * halfHeight, radius * (float)cos(alpha + alpha_inc) };
-
-		// triangle on top base
-		writePoint(topBaseCenter, file);
-		writePoint(p1, file);
-		writePoint(p2, file);
-
-		// square on lateral side
-		writeSquare(p1, p2, p3, p4, file);
-
-		// triangle on bottom base
-		writePoint(botBaseCenter, file);
-		writePoint(p4, file);
-		writePoint(p3, file);
-
-		alpha += alpha_inc;
-	}
-	file.close();
-}
+	key.add(MODEL_FORMAT_VERSION);
+	key.add(args[0]);
+	key.add((int)format);
 
-void generatePrimitive(int argc, char* argv[], int primitive)
-{
-	switch (primitive)
+	switch (primitiveCode(args[0]))
 	{
 	case 1:
 		if (argc < 5)
 		{
 			std::cout << "Insuficient arguments for plane, requires 4!" << std::endl;
+			return false;
 		}
 		else
 		{
-			int length = stoi(argv[2]);
-			int division = stoi(argv[3]);
-			char* fileName = argv[4];
-			plane(length, division, fileName);
+			int length = stoi(args[1]);
+			int division = stoi(args[2]);
+			fileName = args[3];
+			key.add(length);
+			key.add(division);
+			build = [=](const char* f)
+			{
+				Mesh mesh;
+				plane(length, division, mesh);
+				writeModel(mesh, f, format);
+			};
 		}
 		break;
 
@@ -522,13 +217,21 @@ void generatePrimitive(int argc, char* argv[], int primitive)
 		if (argc < 5)
 		{
 			std::cout << "Insuficient arguments for box, requires 4!" << std::endl;
+			return false;
 		}
 		else
 		{
-			int length = stoi(argv[2]);
-			int division = stoi(argv[3]);
-			char* fileName = argv[4];
-			box(length, division, fileName);
+			int length = stoi(args[1]);
+			int division = stoi(args[2]);
+			fileName = args[3];
+			key.add(length);
+			key.add(division);
+			build = [=](const char* f)
+			{
+				Mesh mesh;
+				box(length, division, mesh);
+				writeModel(mesh, f, format);
+			};
 		}
 		break;
 
@@ -536,14 +239,23 @@ void generatePrimitive(int argc, char* argv[], int primitive)
 		if (argc < 6)
 		{
 			std::cout << "Insuficient arguments for sphere, requires 5!" << std::endl;
+			return false;
 		}
 		else
 		{
-			float radius = stof(argv[2]);
-			int slices = stoi(argv[3]);
-			int stacks = stoi(argv[4]);
-			char* fileName = argv[5];
-			sphere(radius, slices, stacks, fileName);
+			float radius = stof(args[1]);
+			int slices = stoi(args[2]);
+			int stacks = stoi(args[3]);
+			fileName = args[4];
+			key.add(radius);
+			key.add(slices);
+			key.add(stacks);
+			build = [=](const char* f)
+			{
+				Mesh mesh;
+				sphere(radius, slices, stacks, mesh);
+				writeModel(mesh, f, format);
+			};
 		}
 		break;
 
@@ -551,52 +263,184 @@ void generatePrimitive(int argc, char* argv[], int primitive)
 		if (argc < 7)
 		{
 			std::cout << "Insuficient arguments for cone, requires 6!" << std::endl;
+			return false;
 		}
 		else
 		{
-			float radius = stof(argv[2]);
-			float height = stof(argv[3]);
-			int slices = stoi(argv[4]);
-			int stacks = stoi(argv[5]);
-			char* fileName = argv[6];
-			cone(radius, height, slices, stacks, fileName);
+			float radius = stof(args[1]);
+			float height = stof(args[2]);
+			int slices = stoi(args[3]);
+			int stacks = stoi(args[4]);
+			fileName = args[5];
+			key.add(radius);
+			key.add(height);
+			key.add(slices);
+			key.add(stacks);
+			build = [=](const char* f)
+			{
+				Mesh mesh;
+				cone(radius, height, slices, stacks, mesh);
+				writeModel(mesh, f, format);
+			};
 		}
 		break;
 
 	case 5:
-		if (argc < 5)
+		if (argc < 6)
 		{
-			std::cout << "Insuficient arguments for cylinder, requires 4!" << std::endl;
+			std::cout << "Insuficient arguments for cylinder, requires 5!" << std::endl;
+			return false;
 		}
 		else
 		{
-			float radius = stof(argv[2]);
-			float height = stof(argv[3]);
-			int slices = stoi(argv[4]);
-			char* fileName = argv[5];
-			cylinder(radius, height, slices, fileName);
+			float radius = stof(args[1]);
+			float height = stof(args[2]);
+			int slices = stoi(args[3]);
+			fileName = args[4];
+			key.add(radius);
+			key.add(height);
+			key.add(slices);
+			build = [=](const char* f)
+			{
+				Mesh mesh;
+				cylinder(radius, height, slices, mesh);
+				writeModel(mesh, f, format);
+			};
 		}
 		break;
+
+	default:
+		std::cout << "Primitive non existent!" << std::endl;
+		return false;
 	}
+
+	generateCached(key, build, fileName);
+	return true;
+}
+
+bool upToDate(const string& output, const filesystem::path& manifest)
+{
+	/*
+	* An output is considered up to date when it exists and was written after
+	* the last change to the manifest, since the manifest is where its spec lives.
+	*/
+	error_code ec;
+	filesystem::file_time_type outputTime = filesystem::last_write_time(output, ec);
+	if (ec)
+		return false;
+
+	filesystem::file_time_type manifestTime = filesystem::last_write_time(manifest, ec);
+	if (ec)
+		return false;
+
+	return outputTime >= manifestTime;
+}
+
+int generateManifest(const char* manifestName, unsigned int threadCount)
+{
+	/*
+	* Manifest format: one primitive per line, written exactly like the
+	* command line arguments of a single invocation, e.g.
+	*
+	*	sphere 1 10 10 sphere.3d
+	*	box 2 3 box.3d
+	*
+	* Blank lines and lines starting with '#' are ignored.
+	*/
+	ifstream manifest(manifestName);
+	if (!manifest)
+	{
+		std::cout << "Could not open manifest " << manifestName << "!" << std::endl;
+		return 1;
+	}
+
+	vector<vector<string>> jobs;
+	string line;
+	int lineNumber = 0;
+	int skipped = 0;
+
+	while (getline(manifest, line))
+	{
+		lineNumber++;
+
+		istringstream tokens(line);
+		vector<string> args;
+		string token;
+		while (tokens >> token)
+			args.push_back(token);
+
+		if (args.empty() || args[0][0] == '#')
+			continue;
+
+		if (primitiveCode(args[0]) == 0 || args.size() < 4)
+		{
+			std::cout << manifestName << ":" << lineNumber << ": invalid primitive spec" << std::endl;
+			continue;
+		}
+
+		if (upToDate(args.back(), manifestName))
+		{
+			skipped++;
+			continue;
+		}
+
+		jobs.push_back(args);
+	}
+	manifest.close();
+
+	// Workers pull the next pending job until the list is exhausted
+	atomic<size_t> nextJob(0);
+	atomic<int> failed(0);
+
+	auto worker = [&]()
+	{
+		size_t job;
+		while ((job = nextJob++) < jobs.size())
+		{
+			try
+			{
+				if (!generatePrimitive(jobs[job]))
+					failed++;
+			}
+			catch (const exception&)
+			{
+				failed++;
+			}
+		}
+	};
+
+	if (threadCount == 0)
+		threadCount = max(1u, thread::hardware_concurrency());
+	threadCount = (unsigned int)min((size_t)threadCount, max((size_t)1, jobs.size()));
+
+	vector<thread> pool;
+	for (unsigned int i = 0; i < threadCount; i++)
+		pool.emplace_back(worker);
+	for (thread& t : pool)
+		t.join();
+
+	std::cout << jobs.size() - failed << " generated (" << cacheHits << " from cache), " << skipped << " up to date, " << failed << " failed" << std::endl;
+
+	return failed > 0 ? 1 : 0;
 }
 
 int main(int argc, char** argv)
 {
+	if (argc >= 3 && string(argv[1]) == "manifest")
+	{
+		unsigned int threads = argc >= 4 ? stoi(argv[3]) : 0;
+		return generateManifest(argv[2], threads);
+	}
+
 	if (argc <= 4) {
 		std::cout << "Insuficient arguments, requires at least 4!" << std::endl;
+		std::cout << "Usage: generator <primitive> <parameters...> <file>" << std::endl;
+		std::cout << "       generator manifest <file> [threads]" << std::endl;
+		std::cout << "Set GENERATOR_CACHE_DIR (e.g. .generator_cache) to reuse models built before;" << std::endl;
+		std::cout << "the directory is never pruned." << std::endl;
 	}
 	else {
-		int primitiveCode = 0;
-		string primitive = argv[1];
-
-		if (primitive == "plane")	primitiveCode = 1;
-		else if (primitive == "box")	primitiveCode = 2;
-		else if (primitive == "sphere")	primitiveCode = 3;
-		else if (primitive == "cone")	primitiveCode = 4;
-		else if (primitive == "cylinder") primitiveCode = 5;
-		else std::cout << "Primitive non existent!" << std::endl;
-
-		generatePrimitive(argc, argv, primitiveCode);
+		generatePrimitive(vector<string>(argv + 1, argv + argc));
 	}
 
 	return 1;
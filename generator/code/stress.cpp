@@ -0,0 +1,295 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <random>
+#include <filesystem>
+#include <math.h>
+#include "primitives.h"
+#include "mesh.h"
+
+using namespace std;
+
+/*
+* Synthetic stress scenes for scalability tests.
+*
+*	stress <scene.xml> [--seed N] [--groups N] [--depth N] [--reuse R]
+*	                   [--triangles N] [--text] [--procedural]
+*
+* Writes a scene of the given number of groups nested up to the given
+* depth, every group with random transforms and one model. The reuse ratio
+* is the fraction of model references that point to a model some other
+* group already uses: 0 gives every group its own model, 0.99 one distinct
+* model per hundred groups. The triangle budget is spread evenly over the
+* distinct models, which are written as binary (or text) files into a
+* directory next to the scene, or referenced as primitive specs with
+* --procedural. The same options and seed always produce the same scene.
+*/
+
+#define STRESS_SEED			1
+#define STRESS_GROUPS		10000
+#define STRESS_DEPTH		4
+#define STRESS_REUSE		0.9
+#define STRESS_TRIANGLES	1000000
+
+class StressModel
+{
+public:
+	string primitive;
+	vector<float> params;		// in buildPrimitive order
+	string file;				// path written into the scene, empty for procedural models
+};
+
+class StressGroup
+{
+public:
+	vector<int> children;
+	int model;
+	float translate[3];
+	float angle;
+	float axis[3];
+	float scale;
+};
+
+mt19937 rng;
+
+// Uniform in [min, max); computed by hand so every platform gives the same numbers
+float uniform(float min, float max)
+{
+	return min + (max - min) * (float)(rng() / 4294967296.0);
+}
+
+int uniformInt(int count)
+{
+	return (int)(rng() % (unsigned int)count);
+}
+
+StressModel makeModel(int triangles)
+{
+	/*
+	* Resolution of a random primitive with about the given number of
+	* triangles: planes, spheres and cones have 2 n^2 at n divisions,
+	* boxes 12 n^2 and cylinders 4 n
+	*/
+	StressModel model;
+	int n2 = max(3, (int)sqrtf(triangles / 2.0f));
+
+	switch (uniformInt(5))
+	{
+	case 0:
+		model.primitive = "plane";
+		model.params = { 1, (float)n2 };
+		break;
+	case 1:
+		model.primitive = "box";
+		model.params = { 1, (float)max(1, (int)sqrtf(triangles / 12.0f)) };
+		break;
+	case 2:
+		model.primitive = "sphere";
+		model.params = { 1, (float)n2, (float)n2 };
+		break;
+	case 3:
+		model.primitive = "cone";
+		model.params = { 1, 2, (float)n2, (float)n2 };
+		break;
+	default:
+		model.primitive = "cylinder";
+		model.params = { 1, 2, (float)max(3, triangles / 4) };
+		break;
+	}
+	return model;
+}
+
+void writeModelElement(ofstream& out, const StressModel& model)
+{
+	static const vector<vector<string>> attributes = {
+		{ "length", "divisions" },
+		{ "radius", "height", "slices", "stacks" },
+		{ "radius", "slices", "stacks" },
+		{ "radius", "height", "slices" }
+	};
+
+	if (!model.file.empty())
+	{
+		out << "<model file=\"" << model.file << "\"/>";
+		return;
+	}
+
+	const vector<string>& names = model.primitive == "plane" || model.primitive == "box" ? attributes[0]
+		: model.primitive == "cone" ? attributes[1]
+		: model.primitive == "sphere" ? attributes[2] : attributes[3];
+
+	out << "<model primitive=\"" << model.primitive << "\"";
+	for (size_t i = 0; i < names.size(); i++)
+		out << " " << names[i] << "=\"" << model.params[i] << "\"";
+	out << "/>";
+}
+
+void writeGroup(ofstream& out, const vector<StressGroup>& groups, const vector<StressModel>& models, int index, int depth)
+{
+	const StressGroup& g = groups[index];
+	string indent(depth, '\t');
+
+	out << indent << "<group>"
+		<< "<translate x=\"" << g.translate[0] << "\" y=\"" << g.translate[1] << "\" z=\"" << g.translate[2] << "\"/>"
+		<< "<rotate angle=\"" << g.angle << "\" x=\"" << g.axis[0] << "\" y=\"" << g.axis[1] << "\" z=\"" << g.axis[2] << "\"/>"
+		<< "<scale x=\"" << g.scale << "\" y=\"" << g.scale << "\" z=\"" << g.scale << "\"/>"
+		<< "<models>";
+	writeModelElement(out, models[g.model]);
+	out << "</models>";
+
+	if (g.children.empty())
+	{
+		out << "</group>\n";
+		return;
+	}
+
+	out << "\n";
+	for (int child : g.children)
+		writeGroup(out, groups, models, child, depth + 1);
+	out << indent << "</group>\n";
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		cout << "Insuficient arguments, specify the scene file!" << endl;
+		return 1;
+	}
+
+	string sceneName = argv[1];
+	unsigned int seed = STRESS_SEED;
+	int groupCount = STRESS_GROUPS;
+	int depth = STRESS_DEPTH;
+	double reuse = STRESS_REUSE;
+	long long triangles = STRESS_TRIANGLES;
+	ModelFormat format = MODEL_BINARY;
+	bool procedural = false;
+
+	for (int i = 2; i < argc; i++)
+	{
+		string option = argv[i];
+		if (option == "--seed" && i + 1 < argc)
+			seed = (unsigned int)stoul(argv[++i]);
+		else if (option == "--groups" && i + 1 < argc)
+			groupCount = max(1, stoi(argv[++i]));
+		else if (option == "--depth" && i + 1 < argc)
+			depth = max(1, stoi(argv[++i]));
+		else if (option == "--reuse" && i + 1 < argc)
+			reuse = min(1.0, max(0.0, stod(argv[++i])));
+		else if (option == "--triangles" && i + 1 < argc)
+			triangles = max(1LL, stoll(argv[++i]));
+		else if (option == "--text")
+			format = MODEL_TEXT;
+		else if (option == "--procedural")
+			procedural = true;
+		else
+		{
+			cout << "Unknown option " << option << "!" << endl;
+			return 1;
+		}
+	}
+
+	rng.seed(seed);
+
+	// Distinct models, each with an even share of the triangle budget
+	int modelCount = max(1, (int)lround(groupCount * (1 - reuse)));
+	int modelTriangles = (int)max(1LL, triangles / modelCount);
+	vector<StressModel> models;
+	for (int i = 0; i < modelCount; i++)
+		models.push_back(makeModel(modelTriangles));
+
+	/*
+	* Tree filled level by level with the branching factor that reaches
+	* the group count at the requested depth, every group hanging from a
+	* random group of the level above
+	*/
+	int branching = max(1, (int)ceil(pow((double)groupCount, 1.0 / depth)));
+	vector<StressGroup> groups(groupCount);
+	vector<int> roots;
+	int levelStart = 0, levelEnd = min(groupCount, branching);
+	for (int i = 0; i < levelEnd; i++)
+		roots.push_back(i);
+	while (levelEnd < groupCount)
+	{
+		int next = min(groupCount, levelEnd + (levelEnd - levelStart) * branching);
+		for (int i = levelEnd; i < next; i++)
+			groups[levelStart + uniformInt(levelEnd - levelStart)].children.push_back(i);
+		levelStart = levelEnd;
+		levelEnd = next;
+	}
+
+	// Transforms spread the groups over a region growing with their number
+	float extent = 2.0f * cbrtf((float)groupCount);
+	for (int i = 0; i < groupCount; i++)
+	{
+		StressGroup& g = groups[i];
+		g.model = i < modelCount ? i : uniformInt(modelCount);
+		for (int k = 0; k < 3; k++)
+			g.translate[k] = uniform(-extent, extent);
+		g.angle = uniform(0, 360);
+		g.axis[0] = uniform(-1, 1);
+		g.axis[1] = 1;
+		g.axis[2] = uniform(-1, 1);
+		g.scale = uniform(0.5f, 1.5f);
+	}
+
+	// Model files go next to the scene, referenced relative to where the engine runs
+	long long written = 0;
+	if (!procedural)
+	{
+		filesystem::path scenePath(sceneName);
+		filesystem::path directory = scenePath.parent_path() / (scenePath.stem().string() + "_models");
+		error_code error;
+		filesystem::create_directories(directory, error);
+
+		for (int i = 0; i < modelCount; i++)
+		{
+			Mesh mesh;
+			buildPrimitive(models[i].primitive, models[i].params, mesh);
+			written += mesh.triangles();
+
+			string file = (directory / ("model" + to_string(i) + (format == MODEL_BINARY ? ".bin" : ".3d"))).string();
+			if (!writeModel(mesh, file.c_str(), format))
+			{
+				cout << "Could not write " << file << "!" << endl;
+				return 1;
+			}
+			models[i].file = file;
+		}
+	}
+
+	ofstream out(sceneName);
+	if (!out)
+	{
+		cout << "Could not write " << sceneName << "!" << endl;
+		return 1;
+	}
+
+	float distance = 3 * extent;
+	out << "<world>\n"
+		<< "<window width=\"800\" height=\"800\"/>\n"
+		<< "<camera>\n"
+		<< "\t<position x=\"" << distance << "\" y=\"" << distance << "\" z=\"" << distance << "\"/>\n"
+		<< "\t<lookAt x=\"0\" y=\"0\" z=\"0\"/>\n"
+		<< "\t<up x=\"0\" y=\"1\" z=\"0\"/>\n"
+		<< "\t<projection fov=\"60\" near=\"1\" far=\"" << 4 * distance << "\"/>\n"
+		<< "</camera>\n";
+	for (int root : roots)
+		writeGroup(out, groups, models, root, 0);
+	out << "</world>\n";
+
+	if (out.fail())
+	{
+		cout << "Could not write " << sceneName << "!" << endl;
+		return 1;
+	}
+
+	cout << sceneName << ": " << groupCount << " groups, " << roots.size() << " top level, depth " << depth
+		 << ", " << modelCount << " distinct models";
+	if (!procedural)
+		cout << ", " << written << " triangles written";
+	cout << endl;
+	return 0;
+}
@@ -0,0 +1,97 @@
+#include <algorithm>
+#include "curve.h"
+
+using namespace std;
+
+void Curve::evaluate(float t, vec3& position, vec3& derivative) const
+{
+	int count = (int)points.size();
+	float gt = t * count;
+	int segment = (int)floorf(gt);
+	float s = gt - segment;
+	segment = ((segment % count) + count) % count;
+
+	const vec3& p0 = points[(segment + count - 1) % count];
+	const vec3& p1 = points[segment];
+	const vec3& p2 = points[(segment + 1) % count];
+	const vec3& p3 = points[(segment + 2) % count];
+
+	/*
+	* Catmull-Rom in polynomial form, with tension 0.5:
+	*	P(s) = a s^3 + b s^2 + c s + p1
+	*/
+	vec3 a = (p0 * -0.5f) + (p1 * 1.5f) + (p2 * -1.5f) + (p3 * 0.5f);
+	vec3 b = p0 + (p1 * -2.5f) + (p2 * 2.0f) + (p3 * -0.5f);
+	vec3 c = (p0 * -0.5f) + (p2 * 0.5f);
+
+	position = ((a * s + b) * s + c) * s + p1;
+	derivative = (a * (3 * s) + b * 2) * s + c;
+}
+
+void Curve::build(int samples)
+{
+	positions.clear();
+	tangents.clear();
+	length = 0;
+
+	if (points.size() < 4 || samples < 2)
+		return;
+
+	/*
+	* First a dense walk over the parameter accumulating chord lengths,
+	* then each table entry finds its parameter by binary search on the
+	* accumulated lengths and is evaluated exactly there.
+	*/
+	int dense = (int)points.size() * 32;
+	vector<float> arc(dense + 1);
+	vec3 previous, position, derivative;
+
+	evaluate(0, previous, derivative);
+	arc[0] = 0;
+	for (int i = 1; i <= dense; i++)
+	{
+		evaluate((float)i / dense, position, derivative);
+		arc[i] = arc[i - 1] + ::length(position - previous);
+		previous = position;
+	}
+	length = arc[dense];
+
+	positions.resize(samples);
+	tangents.resize(samples);
+
+	for (int i = 0; i < samples; i++)
+	{
+		float target = length * i / samples;
+		int j = (int)(upper_bound(arc.begin(), arc.end(), target) - arc.begin());
+		j = min(max(j, 1), dense);
+
+		float span = arc[j] - arc[j - 1];
+		float f = span > 0 ? (target - arc[j - 1]) / span : 0;
+		float t = (j - 1 + f) / dense;
+
+		evaluate(t, positions[i], derivative);
+		tangents[i] = normalize(derivative);
+	}
+}
+
+void Curve::sample(float u, vec3& position, vec3& tangent) const
+{
+	int count = (int)positions.size();
+	if (count == 0)
+	{
+		position = vec3();
+		tangent = vec3(1, 0, 0);
+		return;
+	}
+
+	// Rounding can land a fraction just under 1 on count, which is the start again
+	float x = (u - floorf(u)) * count;
+	if (x >= count)
+		x = 0;
+	int i = (int)x;
+	int next = (i + 1) % count;
+	float f = x - i;
+
+	position = positions[i] + (positions[next] - positions[i]) * f;
+	tangent = normalize(tangents[i] + (tangents[next] - tangents[i]) * f);
+}
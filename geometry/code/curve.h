@@ -0,0 +1,36 @@
+#ifndef CURVE_H
+#define CURVE_H
+
+#include <vector>
+#include "vecmath.h"
+
+/*
+* Closed Catmull-Rom curve through a list of control points.
+*
+* build() samples the curve once and stores positions and tangents at
+* evenly spaced arc lengths, so moving along the curve at constant speed
+* is a table lookup plus a linear interpolation instead of evaluating
+* (and re-parameterizing) the cubic every frame.
+*/
+class Curve
+{
+public:
+	std::vector<vec3> points;		// control points, at least four
+	std::vector<vec3> positions;	// arc length table: positions[i] is at i / size of the length
+	std::vector<vec3> tangents;		// unit tangents matching positions
+	float length = 0;				// total arc length
+
+	Curve() {};
+	Curve(const std::vector<vec3>& controlPoints) : points(controlPoints) {};
+
+	// Exact evaluation at the curve parameter t in [0, 1), spread evenly over the segments
+	void evaluate(float t, vec3& position, vec3& derivative) const;
+
+	// Builds the arc length table with the given number of entries
+	void build(int samples = 128);
+
+	// Position and unit tangent at the arc length fraction u in [0, 1), wraps around
+	void sample(float u, vec3& position, vec3& tangent) const;
+};
+
+#endif
@@ -0,0 +1,265 @@
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <filesystem>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include "mesh.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+void Mesh::bounds(Point& min, Point& max) const
+{
+	pointBounds(vertices.data(), vertices.size(), min, max);
+}
+
+void pointBounds(const Point* points, size_t count, Point& min, Point& max)
+{
+	if (count == 0)
+	{
+		min = max = Point(0, 0, 0);
+		return;
+	}
+
+	min = max = points[0];
+	for (size_t i = 0; i < count; i++)
+	{
+		const Point& p = points[i];
+		if (p.x < min.x) min.x = p.x;
+		if (p.y < min.y) min.y = p.y;
+		if (p.z < min.z) min.z = p.z;
+		if (p.x > max.x) max.x = p.x;
+		if (p.y > max.y) max.y = p.y;
+		if (p.z > max.z) max.z = p.z;
+	}
+}
+
+ModelFormat modelFormatFor(const string& fileName)
+{
+	size_t dot = fileName.rfind('.');
+	if (dot != string::npos && fileName.compare(dot, string::npos, ".bin") == 0)
+		return MODEL_BINARY;
+	return MODEL_TEXT;
+}
+
+static bool readBinaryModel(ifstream& file, Mesh& mesh)
+{
+	uint32_t header[4];
+	if (!file.read((char*)header, MODEL_BINARY_HEADER) || header[1] != MODEL_BINARY_VERSION)
+		return false;
+
+	// The count is checked against what the file holds before anything is allocated for it
+	streampos start = file.tellg();
+	file.seekg(0, ios::end);
+	streamoff remaining = file.tellg() - start;
+	file.seekg(start);
+	if (!file || remaining < 0 || (uint64_t)header[2] * sizeof(Point) > (uint64_t)remaining)
+		return false;
+
+	size_t first = mesh.vertices.size();
+	mesh.vertices.resize(first + header[2]);
+	file.read((char*)&mesh.vertices[first], header[2] * sizeof(Point));
+
+	if (!file)
+	{
+		mesh.vertices.resize(first);
+		return false;
+	}
+	return true;
+}
+
+static void readTextModel(ifstream& file, Mesh& mesh)
+{
+	string linha;
+	float x, y, z;
+
+	while (getline(file, linha, '\0'))
+	{
+		sscanf(linha.c_str(), "%f %f %f", &x, &y, &z);
+		mesh.vertices.push_back(Point(x, y, z));
+	}
+}
+
+bool readModel(const char* fileName, Mesh& mesh)
+{
+	ifstream file(fileName, ios::binary | ios::in);
+	if (!file)
+		return false;
+
+	char magic[4] = { 0 };
+	file.read(magic, sizeof(magic));
+	file.clear();
+	file.seekg(0);
+
+	if (memcmp(magic, MODEL_BINARY_MAGIC, sizeof(magic)) == 0)
+		return readBinaryModel(file, mesh);
+
+	readTextModel(file, mesh);
+	return true;
+}
+
+bool writeModel(const Mesh& mesh, const char* fileName, ModelFormat format)
+{
+	// Written aside and renamed over the old file, which a reader may have mapped
+	ostringstream tmpName;
+	tmpName << fileName << "." << this_thread::get_id() << ".tmp";
+	string tmp = tmpName.str();
+
+	ofstream file(tmp, ios::binary | ios::out);
+	if (!file)
+		return false;
+
+	if (format == MODEL_BINARY)
+	{
+		uint32_t header[4] = { 0, MODEL_BINARY_VERSION, (uint32_t)mesh.vertices.size(), 0 };
+		memcpy(header, MODEL_BINARY_MAGIC, 4);
+		file.write((const char*)header, MODEL_BINARY_HEADER);
+		file.write((const char*)mesh.vertices.data(), mesh.bytes());
+	}
+	else
+	{
+		for (const Point& p : mesh.vertices)
+		{
+			string point = p.toString();
+			file.write(point.c_str(), point.length() + 1);
+		}
+	}
+
+	file.close();
+	error_code ec;
+	if (!file.fail())
+		filesystem::rename(tmp, fileName, ec);
+	if (file.fail() || ec)
+	{
+		filesystem::remove(tmp, ec);
+		return false;
+	}
+	return true;
+}
+
+MappedModel::MappedModel(MappedModel&& other)
+{
+	*this = move(other);
+}
+
+MappedModel::~MappedModel()
+{
+	close();
+}
+
+MappedModel& MappedModel::operator=(MappedModel&& other)
+{
+	if (this != &other)
+	{
+		close();
+		vertices = other.vertices;
+		count = other.count;
+		base = other.base;
+		size = other.size;
+		copy = move(other.copy);
+		if (!copy.vertices.empty())
+			vertices = copy.vertices.data();
+
+		other.vertices = NULL;
+		other.count = 0;
+		other.base = NULL;
+		other.size = 0;
+	}
+	return *this;
+}
+
+bool MappedModel::open(const char* fileName)
+{
+	close();
+
+#ifndef _WIN32
+	int fd = ::open(fileName, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+	void* mapping = MAP_FAILED;
+	if (fstat(fd, &info) == 0 && (size_t)info.st_size >= MODEL_BINARY_HEADER)
+		mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (mapping == MAP_FAILED)
+		return false;
+
+	// Only binary models of the known version are used in place
+	const uint32_t* header = (const uint32_t*)mapping;
+	if (memcmp(header, MODEL_BINARY_MAGIC, 4) != 0 || header[1] != MODEL_BINARY_VERSION
+		|| MODEL_BINARY_HEADER + (size_t)header[2] * sizeof(Point) > (size_t)info.st_size)
+	{
+		munmap(mapping, info.st_size);
+		return false;
+	}
+
+	base = mapping;
+	size = info.st_size;
+	count = header[2];
+	vertices = (const Point*)((const char*)mapping + MODEL_BINARY_HEADER);
+	return true;
+#else
+	if (modelFormatFor(fileName) != MODEL_BINARY || !readModel(fileName, copy))
+		return false;
+	vertices = copy.vertices.data();
+	count = copy.vertices.size();
+	return true;
+#endif
+}
+
+void MappedModel::close()
+{
+#ifndef _WIN32
+	if (base != NULL)
+		munmap(base, size);
+#endif
+	copy = Mesh();
+	vertices = NULL;
+	count = 0;
+	base = NULL;
+	size = 0;
+}
+
+void MappedModel::view(const Point* points, size_t pointCount)
+{
+	close();
+	vertices = points;
+	count = pointCount;
+}
+
+#ifndef _WIN32
+// Advice for the pages holding the vertices, which may share pages with other data
+static void adviseVertices(const Point* vertices, size_t bytes, int advice)
+{
+	if (vertices == NULL || bytes == 0)
+		return;
+
+	uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+	uintptr_t start = (uintptr_t)vertices & ~(page - 1);
+	madvise((void*)start, (uintptr_t)vertices + bytes - start, advice);
+}
+#endif
+
+void MappedModel::prefetch() const
+{
+#ifndef _WIN32
+	adviseVertices(vertices, bytes(), MADV_WILLNEED);
+#endif
+}
+
+void MappedModel::release() const
+{
+	// Read-only file pages are never dirty, so they can simply be dropped
+#ifndef _WIN32
+	adviseVertices(vertices, bytes(), MADV_DONTNEED);
+#endif
+}
@@ -0,0 +1,132 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <vector>
+#include <string>
+
+/*
+* Mesh container and model file readers/writers shared by the generator
+* and the engine.
+*
+* Two model formats are supported:
+*	text	every vertex written as "x y z" followed by a '\0' separator
+*			(the original format, still the default)
+*	binary	a 16 byte header followed by the vertices as packed floats,
+*			so a file can be loaded (or mapped) without any parsing
+*/
+
+class Point {
+public:
+	float x;
+	float y;
+	float z;
+
+	Point() {};
+	Point(float xCoord, float yCoord, float zCoord)
+	{
+		x = xCoord;
+		y = yCoord;
+		z = zCoord;
+	}
+
+	std::string toString() const
+	{
+		return std::to_string(x) + " " + std::to_string(y) + " " + std::to_string(z);
+	}
+};
+
+class Mesh
+{
+public:
+	// Vertices of the mesh triangles, three per triangle
+	std::vector<Point> vertices;
+
+	size_t triangles() const
+	{
+		return vertices.size() / 3;
+	}
+
+	size_t bytes() const
+	{
+		return vertices.size() * sizeof(Point);
+	}
+
+	// Axis aligned bounds of the vertices, both zero for an empty mesh
+	void bounds(Point& min, Point& max) const;
+};
+
+// Axis aligned bounds of count points, both zero when there are none
+void pointBounds(const Point* points, size_t count, Point& min, Point& max);
+
+enum ModelFormat
+{
+	MODEL_TEXT,
+	MODEL_BINARY
+};
+
+/*
+* Binary model layout, all values little endian:
+*	char[4]		magic "CGMB"
+*	uint32		format version
+*	uint32		vertex count
+*	uint32		reserved, zero
+*	float[3]	one x y z triple per vertex
+*/
+#define MODEL_BINARY_MAGIC		"CGMB"
+#define MODEL_BINARY_VERSION	1
+#define MODEL_BINARY_HEADER		16
+
+// Binary for files ending in ".bin", text otherwise
+ModelFormat modelFormatFor(const std::string& fileName);
+
+// Reads a model in either format (detected from the file contents), false if the file can't be read
+bool readModel(const char* fileName, Mesh& mesh);
+
+// Replaces the file in one rename, so readers (and mappings of the old file) never see it half written
+bool writeModel(const Mesh& mesh, const char* fileName, ModelFormat format);
+
+/*
+* Binary model file mapped read-only into memory, so its vertices are used
+* in place and the system reads (and drops) the pages as needed. Where
+* mapping isn't available the vertices are read into memory instead.
+*
+* The file must only ever be replaced, as writeModel does, never rewritten
+* in place: truncating a mapped file makes reading its pages fault.
+*/
+class MappedModel
+{
+public:
+	const Point* vertices = NULL;	// NULL when nothing is mapped
+	size_t count = 0;				// vertices
+
+	MappedModel() {};
+	MappedModel(const MappedModel&) = delete;
+	MappedModel(MappedModel&& other);
+	~MappedModel();
+
+	MappedModel& operator=(const MappedModel&) = delete;
+	MappedModel& operator=(MappedModel&& other);
+
+	// False for text models and files that can't be read
+	bool open(const char* fileName);
+	void close();
+
+	// Uses vertices in a read-only file mapping made (and kept) by someone else
+	void view(const Point* points, size_t pointCount);
+
+	size_t bytes() const
+	{
+		return count * sizeof(Point);
+	}
+
+	// Hints that the vertices are about to be read, or won't be for a while
+	void prefetch() const;
+	void release() const;
+
+private:
+	void* base = NULL;		// start of the mapping
+	size_t size = 0;		// length of the mapping
+	Mesh copy;				// vertices read into memory where files can't be mapped
+};
+
+#endif
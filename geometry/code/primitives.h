@@ -0,0 +1,23 @@
+#ifndef PRIMITIVES_H
+#define PRIMITIVES_H
+
+#include <vector>
+#include <string>
+#include "mesh.h"
+
+/*
+* Primitive builders shared by the generator, which writes them to model
+* files, and the engine, which builds procedural models in memory.
+* Every builder appends the vertices of its triangles to mesh.
+*/
+
+void plane(int length, int division, Mesh& mesh);
+void box(int length, int division, Mesh& mesh);
+void sphere(float radius, int slices, int stacks, Mesh& mesh);
+void cone(float radius, float height, int slices, int stacks, Mesh& mesh);
+void cylinder(float radius, float height, int slices, Mesh& mesh);
+
+// Builds a primitive by name, returns false for unknown names or missing parameters
+bool buildPrimitive(const std::string& name, const std::vector<float>& params, Mesh& mesh);
+
+#endif
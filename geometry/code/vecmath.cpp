@@ -0,0 +1,173 @@
+#include "vecmath.h"
+
+void transformPoints(const mat4& m, const float* in, float* out, size_t count)
+{
+#ifdef VECMATH_SSE
+	__m128 c0 = _mm_load_ps(m.m);
+	__m128 c1 = _mm_load_ps(m.m + 4);
+	__m128 c2 = _mm_load_ps(m.m + 8);
+	__m128 c3 = _mm_load_ps(m.m + 12);
+
+	for (size_t i = 0; i < count; i++, in += 3, out += 3)
+	{
+		__m128 v = _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(in[0])), c3);
+		v = _mm_add_ps(v, _mm_mul_ps(c1, _mm_set1_ps(in[1])));
+		v = _mm_add_ps(v, _mm_mul_ps(c2, _mm_set1_ps(in[2])));
+
+		// Store exactly three floats so in place transforms never touch the next point
+		_mm_storel_pi((__m64*)out, v);
+		_mm_store_ss(out + 2, _mm_movehl_ps(v, v));
+	}
+#else
+	for (size_t i = 0; i < count; i++, in += 3, out += 3)
+	{
+		float x = in[0], y = in[1], z = in[2];
+		out[0] = m.m[0] * x + m.m[4] * y + m.m[8] * z + m.m[12];
+		out[1] = m.m[1] * x + m.m[5] * y + m.m[9] * z + m.m[13];
+		out[2] = m.m[2] * x + m.m[6] * y + m.m[10] * z + m.m[14];
+	}
+#endif
+}
+
+void transformPoints(const mat4& m, const vec3* in, vec3* out, size_t count)
+{
+#ifdef VECMATH_SSE
+	__m128 c0 = _mm_load_ps(m.m);
+	__m128 c1 = _mm_load_ps(m.m + 4);
+	__m128 c2 = _mm_load_ps(m.m + 8);
+	__m128 c3 = _mm_load_ps(m.m + 12);
+	// Keeps x y z and clears the padding lane
+	__m128 mask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+
+	for (size_t i = 0; i < count; i++)
+	{
+		__m128 p = _mm_load_ps(&in[i].x);
+		__m128 v = _mm_add_ps(_mm_mul_ps(c0, _mm_shuffle_ps(p, p, _MM_SHUFFLE(0, 0, 0, 0))), c3);
+		v = _mm_add_ps(v, _mm_mul_ps(c1, _mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1))));
+		v = _mm_add_ps(v, _mm_mul_ps(c2, _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2))));
+		_mm_store_ps(&out[i].x, _mm_and_ps(v, mask));
+	}
+#else
+	for (size_t i = 0; i < count; i++)
+		out[i] = m.transformPoint(in[i]);
+#endif
+}
+
+AABB AABB::transformed(const mat4& m) const
+{
+	/*
+	* The transformed center plus the extents projected on each axis
+	* through the absolute values of the matrix (Arvo's method), cheaper
+	* than transforming all eight corners.
+	*/
+	vec3 c = m.transformPoint(center());
+	vec3 e = extents();
+	vec3 r(fabsf(m.m[0]) * e.x + fabsf(m.m[4]) * e.y + fabsf(m.m[8]) * e.z,
+		   fabsf(m.m[1]) * e.x + fabsf(m.m[5]) * e.y + fabsf(m.m[9]) * e.z,
+		   fabsf(m.m[2]) * e.x + fabsf(m.m[6]) * e.y + fabsf(m.m[10]) * e.z);
+	return AABB(c - r, c + r);
+}
+
+Frustum::Frustum()
+{
+	for (int i = 0; i < 8; i++)
+	{
+		nx[i] = ny[i] = nz[i] = 0;
+		d[i] = 1;
+	}
+}
+
+Frustum Frustum::fromMatrix(const mat4& m)
+{
+	/*
+	* Gribb/Hartmann extraction: with r0..r3 the matrix rows, the planes are
+	* r3 + r0 (left), r3 - r0 (right), r3 + r1 (bottom), r3 - r1 (top),
+	* r3 + r2 (near) and r3 - r2 (far).
+	*/
+	Frustum f;
+	for (int i = 0; i < 6; i++)
+	{
+		int row = i / 2;
+		float sign = (i % 2 == 0) ? 1.0f : -1.0f;
+
+		float a = m.at(3, 0) + sign * m.at(row, 0);
+		float b = m.at(3, 1) + sign * m.at(row, 1);
+		float c = m.at(3, 2) + sign * m.at(row, 2);
+		float w = m.at(3, 3) + sign * m.at(row, 3);
+
+		float l = sqrtf(a * a + b * b + c * c);
+		if (l > 0)
+		{
+			a /= l;
+			b /= l;
+			c /= l;
+			w /= l;
+		}
+		f.nx[i] = a;
+		f.ny[i] = b;
+		f.nz[i] = c;
+		f.d[i] = w;
+	}
+	return f;
+}
+
+bool Frustum::intersects(const AABB& box) const
+{
+	/*
+	* For every plane, the box corner furthest along the plane normal is
+	* center + |n| * extents; the box is outside when even that corner is
+	* behind the plane.
+	*/
+	vec3 c = box.center();
+	vec3 e = box.extents();
+
+#if defined(VECMATH_AVX)
+	__m256 dist = _mm256_add_ps(_mm256_load_ps(d), _mm256_mul_ps(_mm256_load_ps(nx), _mm256_set1_ps(c.x)));
+	dist = _mm256_add_ps(dist, _mm256_mul_ps(_mm256_load_ps(ny), _mm256_set1_ps(c.y)));
+	dist = _mm256_add_ps(dist, _mm256_mul_ps(_mm256_load_ps(nz), _mm256_set1_ps(c.z)));
+
+	__m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+	__m256 radius = _mm256_mul_ps(_mm256_and_ps(_mm256_load_ps(nx), absMask), _mm256_set1_ps(e.x));
+	radius = _mm256_add_ps(radius, _mm256_mul_ps(_mm256_and_ps(_mm256_load_ps(ny), absMask), _mm256_set1_ps(e.y)));
+	radius = _mm256_add_ps(radius, _mm256_mul_ps(_mm256_and_ps(_mm256_load_ps(nz), absMask), _mm256_set1_ps(e.z)));
+
+	__m256 outside = _mm256_cmp_ps(_mm256_add_ps(dist, radius), _mm256_setzero_ps(), _CMP_LT_OQ);
+	return _mm256_movemask_ps(outside) == 0;
+#elif defined(VECMATH_SSE)
+	__m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	__m128 cx = _mm_set1_ps(c.x), cy = _mm_set1_ps(c.y), cz = _mm_set1_ps(c.z);
+	__m128 ex = _mm_set1_ps(e.x), ey = _mm_set1_ps(e.y), ez = _mm_set1_ps(e.z);
+
+	for (int i = 0; i < 8; i += 4)
+	{
+		__m128 px = _mm_load_ps(nx + i), py = _mm_load_ps(ny + i), pz = _mm_load_ps(nz + i);
+
+		__m128 dist = _mm_add_ps(_mm_load_ps(d + i), _mm_mul_ps(px, cx));
+		dist = _mm_add_ps(dist, _mm_mul_ps(py, cy));
+		dist = _mm_add_ps(dist, _mm_mul_ps(pz, cz));
+
+		__m128 radius = _mm_mul_ps(_mm_and_ps(px, absMask), ex);
+		radius = _mm_add_ps(radius, _mm_mul_ps(_mm_and_ps(py, absMask), ey));
+		radius = _mm_add_ps(radius, _mm_mul_ps(_mm_and_ps(pz, absMask), ez));
+
+		if (_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(dist, radius), _mm_setzero_ps())) != 0)
+			return false;
+	}
+	return true;
+#else
+	for (int i = 0; i < 6; i++)
+	{
+		float dist = nx[i] * c.x + ny[i] * c.y + nz[i] * c.z + d[i];
+		float radius = fabsf(nx[i]) * e.x + fabsf(ny[i]) * e.y + fabsf(nz[i]) * e.z;
+		if (dist + radius < 0)
+			return false;
+	}
+	return true;
+#endif
+}
+
+void Frustum::intersects(const AABB* boxes, size_t count, unsigned char* visible) const
+{
+	for (size_t i = 0; i < count; i++)
+		visible[i] = intersects(boxes[i]) ? 1 : 0;
+}
@@ -0,0 +1,289 @@
+#ifndef VECMATH_H
+#define VECMATH_H
+
+#include <math.h>
+#include <stddef.h>
+
+/*
+* Vector and matrix types shared by the engine and the tools.
+*
+* vec3 is padded to four floats and mat4 is stored column-major (the layout
+* OpenGL expects), both 16 byte aligned, so every row/column maps straight
+* onto a SIMD register. Matrix products, batched point transforms and the
+* frustum tests use SSE2 (and AVX where enabled) with a scalar fallback for
+* other targets; VECMATH_NO_SIMD forces the scalar paths.
+*/
+
+#if !defined(VECMATH_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define VECMATH_SSE
+#include <emmintrin.h>
+#endif
+
+#if defined(VECMATH_SSE) && defined(__AVX__)
+#define VECMATH_AVX
+#include <immintrin.h>
+#endif
+
+#ifndef VECMATH_PI
+#define VECMATH_PI 3.14159265358979323846f
+#endif
+
+class alignas(16) vec3
+{
+public:
+	float x;
+	float y;
+	float z;
+	float w; // padding, always zero
+
+	vec3() : x(0), y(0), z(0), w(0) {};
+	vec3(float xCoord, float yCoord, float zCoord) : x(xCoord), y(yCoord), z(zCoord), w(0) {};
+
+	vec3 operator+(const vec3& v) const { return vec3(x + v.x, y + v.y, z + v.z); }
+	vec3 operator-(const vec3& v) const { return vec3(x - v.x, y - v.y, z - v.z); }
+	vec3 operator*(float s) const { return vec3(x * s, y * s, z * s); }
+	vec3 operator-() const { return vec3(-x, -y, -z); }
+	vec3& operator+=(const vec3& v) { x += v.x; y += v.y; z += v.z; return *this; }
+	vec3& operator-=(const vec3& v) { x -= v.x; y -= v.y; z -= v.z; return *this; }
+	bool operator==(const vec3& v) const { return x == v.x && y == v.y && z == v.z; }
+	bool operator!=(const vec3& v) const { return !(*this == v); }
+};
+
+inline float dot(const vec3& a, const vec3& b)
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline vec3 cross(const vec3& a, const vec3& b)
+{
+	return vec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+
+inline float length(const vec3& v)
+{
+	return sqrtf(dot(v, v));
+}
+
+inline vec3 normalize(const vec3& v)
+{
+	float l = length(v);
+	return l > 0 ? v * (1.0f / l) : v;
+}
+
+class alignas(16) vec4
+{
+public:
+	float x;
+	float y;
+	float z;
+	float w;
+
+	vec4() : x(0), y(0), z(0), w(0) {};
+	vec4(float xCoord, float yCoord, float zCoord, float wCoord) : x(xCoord), y(yCoord), z(zCoord), w(wCoord) {};
+	vec4(const vec3& v, float wCoord) : x(v.x), y(v.y), z(v.z), w(wCoord) {};
+
+	vec3 xyz() const { return vec3(x, y, z); }
+};
+
+class alignas(16) mat4
+{
+public:
+	float m[16]; // column major: element (row, col) is m[col * 4 + row]
+
+	mat4()
+	{
+		for (int i = 0; i < 16; i++)
+			m[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+	}
+
+	float& at(int row, int col) { return m[col * 4 + row]; }
+	float at(int row, int col) const { return m[col * 4 + row]; }
+
+	mat4 operator*(const mat4& b) const
+	{
+		mat4 r;
+#ifdef VECMATH_SSE
+		// Each result column is a combination of our columns weighted by b's column
+		__m128 c0 = _mm_load_ps(m);
+		__m128 c1 = _mm_load_ps(m + 4);
+		__m128 c2 = _mm_load_ps(m + 8);
+		__m128 c3 = _mm_load_ps(m + 12);
+		for (int col = 0; col < 4; col++)
+		{
+			const float* bc = b.m + col * 4;
+			__m128 v = _mm_mul_ps(c0, _mm_set1_ps(bc[0]));
+			v = _mm_add_ps(v, _mm_mul_ps(c1, _mm_set1_ps(bc[1])));
+			v = _mm_add_ps(v, _mm_mul_ps(c2, _mm_set1_ps(bc[2])));
+			v = _mm_add_ps(v, _mm_mul_ps(c3, _mm_set1_ps(bc[3])));
+			_mm_store_ps(r.m + col * 4, v);
+		}
+#else
+		for (int col = 0; col < 4; col++)
+		{
+			for (int row = 0; row < 4; row++)
+			{
+				r.m[col * 4 + row] = m[0 * 4 + row] * b.m[col * 4 + 0]
+								   + m[1 * 4 + row] * b.m[col * 4 + 1]
+								   + m[2 * 4 + row] * b.m[col * 4 + 2]
+								   + m[3 * 4 + row] * b.m[col * 4 + 3];
+			}
+		}
+#endif
+		return r;
+	}
+
+	vec4 operator*(const vec4& v) const
+	{
+		return vec4(m[0] * v.x + m[4] * v.y + m[8] * v.z + m[12] * v.w,
+					m[1] * v.x + m[5] * v.y + m[9] * v.z + m[13] * v.w,
+					m[2] * v.x + m[6] * v.y + m[10] * v.z + m[14] * v.w,
+					m[3] * v.x + m[7] * v.y + m[11] * v.z + m[15] * v.w);
+	}
+
+	vec3 transformPoint(const vec3& p) const
+	{
+		return vec3(m[0] * p.x + m[4] * p.y + m[8] * p.z + m[12],
+					m[1] * p.x + m[5] * p.y + m[9] * p.z + m[13],
+					m[2] * p.x + m[6] * p.y + m[10] * p.z + m[14]);
+	}
+
+	vec3 transformVector(const vec3& v) const
+	{
+		return vec3(m[0] * v.x + m[4] * v.y + m[8] * v.z,
+					m[1] * v.x + m[5] * v.y + m[9] * v.z,
+					m[2] * v.x + m[6] * v.y + m[10] * v.z);
+	}
+
+	static mat4 identity()
+	{
+		return mat4();
+	}
+
+	// Same as glTranslatef
+	static mat4 translate(float x, float y, float z)
+	{
+		mat4 r;
+		r.m[12] = x;
+		r.m[13] = y;
+		r.m[14] = z;
+		return r;
+	}
+
+	// Same as glScalef
+	static mat4 scale(float x, float y, float z)
+	{
+		mat4 r;
+		r.m[0] = x;
+		r.m[5] = y;
+		r.m[10] = z;
+		return r;
+	}
+
+	// Same as glRotatef: angle in degrees around the axis (x, y, z)
+	static mat4 rotate(float angle, float x, float y, float z)
+	{
+		vec3 a = normalize(vec3(x, y, z));
+		float rad = angle * VECMATH_PI / 180.0f;
+		float c = cosf(rad), s = sinf(rad), t = 1 - c;
+
+		mat4 r;
+		r.at(0, 0) = t * a.x * a.x + c;		  r.at(0, 1) = t * a.x * a.y - s * a.z; r.at(0, 2) = t * a.x * a.z + s * a.y;
+		r.at(1, 0) = t * a.x * a.y + s * a.z; r.at(1, 1) = t * a.y * a.y + c;		r.at(1, 2) = t * a.y * a.z - s * a.x;
+		r.at(2, 0) = t * a.x * a.z - s * a.y; r.at(2, 1) = t * a.y * a.z + s * a.x; r.at(2, 2) = t * a.z * a.z + c;
+		return r;
+	}
+
+	// Same as gluPerspective: vertical field of view in degrees
+	static mat4 perspective(float fov, float aspect, float zNear, float zFar)
+	{
+		float f = 1.0f / tanf(fov * VECMATH_PI / 360.0f);
+
+		mat4 r;
+		r.at(0, 0) = f / aspect;
+		r.at(1, 1) = f;
+		r.at(2, 2) = (zFar + zNear) / (zNear - zFar);
+		r.at(2, 3) = 2 * zFar * zNear / (zNear - zFar);
+		r.at(3, 2) = -1;
+		r.at(3, 3) = 0;
+		return r;
+	}
+
+	// Same as gluLookAt
+	static mat4 lookAt(const vec3& eye, const vec3& center, const vec3& up)
+	{
+		vec3 f = normalize(center - eye);
+		vec3 s = normalize(cross(f, up));
+		vec3 u = cross(s, f);
+
+		mat4 r;
+		r.at(0, 0) = s.x;  r.at(0, 1) = s.y;  r.at(0, 2) = s.z;
+		r.at(1, 0) = u.x;  r.at(1, 1) = u.y;  r.at(1, 2) = u.z;
+		r.at(2, 0) = -f.x; r.at(2, 1) = -f.y; r.at(2, 2) = -f.z;
+		return r * translate(-eye.x, -eye.y, -eye.z);
+	}
+};
+
+/*
+* Batched affine transform of point arrays (w = 1), out may alias in.
+* The packed variant works on tightly packed x y z triples, such as mesh
+* vertices; the vec3 variant uses the padded, aligned layout.
+*/
+void transformPoints(const mat4& m, const float* in, float* out, size_t count);
+void transformPoints(const mat4& m, const vec3* in, vec3* out, size_t count);
+
+class AABB
+{
+public:
+	vec3 min;
+	vec3 max;
+
+	AABB() {};
+	AABB(const vec3& newMin, const vec3& newMax) : min(newMin), max(newMax) {};
+
+	vec3 center() const { return (min + max) * 0.5f; }
+	vec3 extents() const { return (max - min) * 0.5f; }
+
+	// Grows the box to include p
+	void extend(const vec3& p)
+	{
+		if (p.x < min.x) min.x = p.x;
+		if (p.y < min.y) min.y = p.y;
+		if (p.z < min.z) min.z = p.z;
+		if (p.x > max.x) max.x = p.x;
+		if (p.y > max.y) max.y = p.y;
+		if (p.z > max.z) max.z = p.z;
+	}
+
+	// Smallest axis aligned box containing this box transformed by m
+	AABB transformed(const mat4& m) const;
+};
+
+class Frustum
+{
+public:
+	/*
+	* The six planes (left, right, bottom, top, near, far) stored as
+	* structure of arrays, padded to eight with planes that accept
+	* everything, so a box is tested against all of them in two SSE steps
+	* (one with AVX). A point p is inside a plane when n . p + d >= 0.
+	*/
+	alignas(32) float nx[8];
+	alignas(32) float ny[8];
+	alignas(32) float nz[8];
+	alignas(32) float d[8];
+
+	Frustum();
+
+	// Extracts the planes from a projection * view (or projection * view * model) matrix
+	static Frustum fromMatrix(const mat4& m);
+
+	vec4 plane(int i) const { return vec4(nx[i], ny[i], nz[i], d[i]); }
+
+	// False only when the box is entirely outside one of the planes
+	bool intersects(const AABB& box) const;
+
+	// Tests count boxes, storing 1 in visible[i] when box i intersects the frustum
+	void intersects(const AABB* boxes, size_t count, unsigned char* visible) const;
+};
+
+#endif